@@ -6,38 +6,218 @@
 
 #include <openvslam/config.h>
 #include <openvslam/system.h>
+#include <openvslam/camera/base.h>
+#include <openvslam/data/keyframe.h>
+#include <openvslam/data/map_database.h>
 
-#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
+
+#include <yaml-cpp/yaml.h>
+
+#include "utils/Affinity.hpp"
+#include "utils/AllocCounter.hpp"
 
 namespace qrslam {
 
+//-------------------------------------------------------------
+// app.yaml
+//-------------------------------------------------------------
+AppParams loadAppParams(const std::string& path) {
+    const YAML::Node y = YAML::LoadFile(path);
+    AppParams p;
+
+    p.cam_id  = y["camera_id"].as<int>(p.cam_id);
+    if (const auto w = y["window"]) {
+        p.width  = w["width"].as<int>(p.width);
+        p.height = w["height"].as<int>(p.height);
+    }
+    p.cam_fps = y["fps_target"].as<double>(p.cam_fps);
+
+    if (const auto q = y["qr_scan"]) {
+        p.qr_scan_enable   = q["enable"].as<bool>(p.qr_scan_enable);
+        p.qr_scan_interval = q["interval_frame"].as<int>(p.qr_scan_interval);
+        p.qr_detector      = q["detector"].as<std::string>(p.qr_detector);
+        p.marker_size      = q["marker_size_m"].as<double>(p.marker_size);
+    }
+
+    if (const auto m = y["markers"]) {
+        p.anchor_refresh_frames = m["anchor_refresh_frames"].as<int>(p.anchor_refresh_frames);
+    }
+
+    if (const auto m = y["map"]) {
+        const auto mode = m["mode"].as<std::string>("slam");
+        if (mode != "slam" && mode != "localization")
+            throw std::invalid_argument("unknown map.mode '" + mode + "' (slam | localization)");
+        p.localization   = mode == "localization";
+        p.map_path       = m["path"].as<std::string>(p.map_path);
+        p.marker_db_path = m["markers"].as<std::string>(p.marker_db_path);
+    }
+
+    if (const auto r = y["rgbd"]) {
+        p.rgbd_dataset = r["dataset"].as<std::string>(p.rgbd_dataset);
+    }
+
+    if (const auto r = y["record"]; r && r["enable"].as<bool>(false)) {
+        auto& rp    = p.record;
+        rp.path     = r["path"].as<std::string>("overlay.avi");
+        rp.fourcc   = r["fourcc"].as<std::string>(rp.fourcc);
+        rp.fps      = r["fps"].as<double>(rp.fps);
+        rp.queue    = r["queue"].as<std::size_t>(rp.queue);
+        rp.policy   = VideoRecorder::parsePolicy(r["policy"].as<std::string>("drop_oldest"));
+        rp.decimate = r["decimate"].as<int>(rp.decimate);
+    }
+
+    if (const auto s = y["session"]; s && s["enable"].as<bool>(false)) {
+        auto& sp       = p.session;
+        sp.path        = s["path"].as<std::string>("session.qrs");
+        sp.compress    = s["compress"].as<bool>(sp.compress);
+        sp.chunk_bytes = s["chunk_mb"].as<std::size_t>(sp.chunk_bytes >> 20) << 20;
+        sp.queue       = s["queue"].as<std::size_t>(sp.queue);
+    }
+
+    if (const auto o = y["marker_odometry"]) {
+        p.marker_odometry  = o["enable"].as<bool>(p.marker_odometry);
+        p.odo.min_markers  = o["min_markers"].as<int>(p.odo.min_markers);
+        p.odo.min_obs      = o["min_obs"].as<int>(p.odo.min_obs);
+        p.odo.max_rms_px   = o["max_rms_px"].as<double>(p.odo.max_rms_px);
+        p.odo_slam_every   = o["slam_every"].as<int>(p.odo_slam_every);
+    }
+
+    if (const auto g = y["motion_gate"]) {
+        p.motion_gate = g["enable"].as<bool>(p.motion_gate);
+        auto& gp = p.gate;
+        gp.thumb_width      = g["thumb_width"].as<int>(gp.thumb_width);
+        gp.tiles_x          = g["tiles_x"].as<int>(gp.tiles_x);
+        gp.tiles_y          = g["tiles_y"].as<int>(gp.tiles_y);
+        gp.threshold        = g["threshold"].as<double>(gp.threshold);
+        gp.keepalive_frames = g["keepalive_frames"].as<int>(gp.keepalive_frames);
+    }
+
+    if (const auto g = y["map_growth"]) {
+        auto& gp = p.growth;
+        gp.period_frames    = g["period_frames"].as<int>(gp.period_frames);
+        gp.max_keyframes    = g["max_keyframes"].as<std::size_t>(gp.max_keyframes);
+        gp.cull_batch       = g["cull_batch"].as<int>(gp.cull_batch);
+        gp.redundant_ratio  = g["redundant_ratio"].as<double>(gp.redundant_ratio);
+        gp.min_observers    = g["min_observers"].as<int>(gp.min_observers);
+        gp.marker_max_age_h = g["marker_max_age_h"].as<double>(gp.marker_max_age_h);
+    }
+
+    if (const auto t = y["threads"]) {
+        p.pool.threads   = t["pool_size"].as<int>(p.pool.threads);
+        p.pool.cpus      = t["pool_cpus"].as<std::vector<int>>(p.pool.cpus);
+        p.slam_cpus      = t["slam_cpus"].as<std::vector<int>>(p.slam_cpus);
+        p.opencv_threads = t["opencv_threads"].as<int>(p.opencv_threads);
+    }
+
+    if (const auto t = y["trace"]) {
+        if (t["enable"].as<bool>(false))
+            p.trace_path = t["path"].as<std::string>("trace.json");
+        p.latency_report_every = t["latency_report_every"].as<int>(p.latency_report_every);
+    }
+    return p;
+}
+
 //-------------------------------------------------------------
 // ctor / dtor
 //-------------------------------------------------------------
-App::App(const AppParams& params) : p_{params} {
+App::App(const AppParams& params)
+    : p_{params}, arena_{params.frame_arena_bytes} {
+
+    // --- потоки: пул задач, запись, привязка к ядрам ---------------------
+    // новый поток наследует маску создателя: потоки записи создаются под
+    // маской пула, mapping / loop closing (startup) — под маской SLAM
+    if (p_.opencv_threads >= 0) cv::setNumThreads(p_.opencv_threads);
+    pool_ = std::make_unique<TaskPool>(p_.pool);
+    {
+        util::ScopedAffinity on_pool(p_.pool.cpus);
+        if (!p_.record.path.empty())
+            recorder_ = std::make_unique<VideoRecorder>(p_.record);
+        if (!p_.session.path.empty())
+            session_ = std::make_unique<SessionWriter>(p_.session);
+    }
+    if (!util::pinCurrentThread(p_.slam_cpus))
+        std::cerr << "[threads] cannot pin SLAM threads to threads.slam_cpus\n";
+    std::cout << "[threads] pool " << pool_->size() << " workers"
+              << (p_.pool.cpus.empty() ? "" : " (pinned)")
+              << (p_.slam_cpus.empty() ? "" : ", SLAM pinned") << "\n";
 
     // --- SLAM конфигурация и система ----------------------------------
     cfg_  = std::make_shared<openvslam::config>(p_.config_path);
     slam_ = std::make_unique<openvslam::system>(cfg_, p_.vocab_path);
-    slam_->startup();
+    if (p_.localization) {
+        // готовая карта: без инициализации и без local mapping — только
+        // трекинг и релокализация, новые кейфреймы не создаются
+        if (p_.map_path.empty())
+            throw std::runtime_error("map.mode localization requires map.path");
+        if (!slam_->load_map_database(p_.map_path))
+            throw std::runtime_error("Cannot load map " + p_.map_path);
+        slam_->startup(false);
+        slam_->disable_mapping_module();
+        std::cout << "[map] localization only, map " << p_.map_path << "\n";
+    } else {
+        slam_->startup();
+    }
+
+    // --- QR-детектор и карта маркеров ----------------------------------
+    qrdet_ = makeQrDetector(p_.qr_detector);
+    const auto& cam = cfg_->camera_;
+    tracker_ = std::make_unique<MarkerTracker>(
+        MarkerTracker::CameraIntrinsics{cam->fx_, cam->fy_, cam->cx_, cam->cy_});
+    const YAML::Node cam_yaml = YAML::LoadFile(p_.config_path);
+    tracker_->setCameraModel(geom::cameraModelFromConfig(
+        cam_yaml, static_cast<int>(cam->cols_), static_cast<int>(cam->rows_)));
+    if (p_.localization) {
+        if (!p_.marker_db_path.empty() && !tracker_->load(p_.marker_db_path))
+            throw std::runtime_error("Cannot load marker DB " + p_.marker_db_path);
+        tracker_->setReadOnly(true);
+        need_scan_ = false;                       // маркеры уже известны
+    }
+    std::cout << "[scan] detector: " << qrdet_->name() << "\n";
+
+    // --- источник кадров: камера или RGB-D набор с диска ----------------
+    rgbd_ = cam->setup_type_ == openvslam::camera::setup_type_t::RGBD;
+    if (rgbd_) {
+        if (p_.rgbd_dataset.empty())
+            throw std::runtime_error("Camera.setup RGBD requires rgbd.dataset in app.yaml");
+        depth_factor_ = cam_yaml["depthmap_factor"].as<double>(1.0);
+        dataset_ = std::make_unique<RgbdDataset>(p_.rgbd_dataset);
+        std::cout << "[rgbd] replay " << p_.rgbd_dataset
+                  << "  depthmap_factor=" << depth_factor_ << "\n";
+    } else {
+        cap_.open(p_.cam_id, cv::CAP_ANY);
+        if (!cap_.isOpened())
+            throw std::runtime_error("Cannot open camera " + std::to_string(p_.cam_id));
+
+        cap_.set(cv::CAP_PROP_FRAME_WIDTH,  p_.width);
+        cap_.set(cv::CAP_PROP_FRAME_HEIGHT, p_.height);
+        cap_.set(cv::CAP_PROP_FPS,          p_.cam_fps);
+    }
+
+    // --- телеметрия карты и лимиты роста (фоном, в пуле) ------------------
+    housekeeper_ = std::make_unique<MapHousekeeper>(p_.growth, *slam_, *pool_, !p_.localization);
 
-    // --- камера --------------------------------------------------------
-    cap_.open(p_.cam_id, cv::CAP_ANY);
-    if (!cap_.isOpened())
-        throw std::runtime_error("Cannot open camera " + std::to_string(p_.cam_id));
+    // --- гейт движения ---------------------------------------------------
+    if (p_.motion_gate)
+        gate_ = std::make_unique<MotionGate>(p_.gate);
 
-    cap_.set(cv::CAP_PROP_FRAME_WIDTH,  p_.width);
-    cap_.set(cv::CAP_PROP_FRAME_HEIGHT, p_.height);
-    cap_.set(cv::CAP_PROP_FPS,          p_.cam_fps);
+    // --- трассировка кадров -------------------------------------------
+    trace::Tracer::instance().enable(!p_.trace_path.empty());
 
     std::cout << "QR-SLAM demo started  (ESC exit | SPACE scan | R reset)\n";
 }
 
 App::~App() {
+    housekeeper_.reset();                     // дождаться фонового шага до shutdown
+    if (recorder_) recorder_->stop();
+    if (session_)  session_->stop();
     if (slam_) {
         slam_->shutdown();
+        if (!p_.localization) saveMaps();
     }
 }
 
@@ -49,53 +229,278 @@ void App::run() {
     cv::namedWindow(kWin, cv::WINDOW_NORMAL);
     double t0 = static_cast<double>(cv::getTickCount());
 
+    cv::Mat frame_bgr;
     while (true) {
-        cv::Mat frame_bgr;
-        cap_ >> frame_bgr;
+        util::FrameAllocProbe allocs;
+
+        // ------ кадр + timestamp в секундах ------
+        trace::Scope capture("capture", frame_id_);
+        double ts = 0.0;
+        if (dataset_) {
+            if (!dataset_->next(frame_bgr, depth_, ts)) frame_bgr.release();
+        } else {
+            cap_ >> frame_bgr;
+            ts = (cv::getTickCount() - t0) / cv::getTickFrequency();
+        }
+        capture.end();
         if (frame_bgr.empty()) break;
+        // «стекло» — кадр уже получен: ожидание следующего кадра камеры
+        // в задержку не входит; часы свои, не зависят от трассировки
+        const std::int64_t glass_ns = trace::nowNs();
+
+        // вся не-SLAM работа кадра — задачи пула; главный поток (ядра SLAM)
+        // в Group::wait спит, а не выполняет их
+        TaskPool::Group frame_tasks(*pool_);
+
+        // ------ сырой кадр в лог сессии (копия: дальше рисуется overlay) ------
+        if (session_) {
+            frame_tasks.run([this, &frame_bgr, ts, id = frame_id_] {
+                util::TaskAllocProbe allocs(frame_allocs_);
+                trace::Scope sc("session", id);
+                session_->pushFrame(id, ts, frame_bgr, rgbd_ ? depth_ : cv::Mat());
+            });
+        }
 
-        cv::Mat frame_rgb;
-        cv::cvtColor(frame_bgr, frame_rgb, cv::COLOR_BGR2RGB);
-        cv::Mat frame_gray;
-        cv::cvtColor(frame_bgr, frame_gray, cv::COLOR_BGR2GRAY);
-
-        // ------ timestamp в секундах ------
-        double ts = (cv::getTickCount() - t0) / cv::getTickFrequency();
-
-        // ------ SLAM ------
-        Eigen::Matrix4d T_cw = slam_->feed_monocular_frame(frame_rgb, ts);
-
-        // ------ первичный / ручной скан ------
-        if (need_scan_) {
-            detectAndRegisterMarkers(frame_gray, frame_rgb, T_cw);
+        // ------ гейт движения: сцена стоит → ни SLAM, ни QR, поза прежняя ------
+        bool still = false;
+        if (gate_) {
+            trace::Scope sc("gate", frame_id_);
+            // скан обязателен → кадр обрабатывается: не считать его пропуском
+            // и сделать опорой для следующих сравнений
+            if (need_scan_) gate_->reset();
+            still = gate_->isStatic(frame_bgr);
+            if (still != gate_idle_) {
+                std::cout << (still ? "[gate] static scene, SLAM/QR paused\n"
+                                    : "[gate] motion, resumed\n");
+                gate_idle_ = still;
+            }
+        }
+        FrameStep step{last_T_cw_};
+        if (!still) {
+            step = processFrame(frame_bgr, ts, frame_tasks);
+            last_T_cw_       = step.T_cw;
+            last_by_markers_ = step.by_markers;
+        }
+        const Eigen::Matrix4d& T_cw = last_T_cw_;
+
+        // ------ регистрация скана / давность маркеров + overlay: задача пула ------
+        // (копия кадра в сессию должна закончиться до рисования; трекер
+        // маркеров однопоточный — главный поток его не трогает, пока ждёт)
+        {
+            trace::Scope sc("pool_wait", frame_id_);
+            frame_tasks.wait();
+        }
+        frame_tasks.run([this, &frame_bgr, &T_cw, ts, still, reg = step.register_dets,
+                         only_new = step.by_markers] {
+            util::TaskAllocProbe allocs(frame_allocs_);
+            if (reg) registerMarkers(T_cw, need_scan_, only_new);
+            // гейт стоит — QR не ищется, но маркеры в кадре по-прежнему
+            // видны: иначе их вытеснило бы по давности
+            if (still && p_.growth.marker_max_age_h > 0.0) {
+                trace::Scope sc("mark_seen", frame_id_);
+                tracker_->markSeenInView(T_cw, frame_bgr.cols, frame_bgr.rows, ts);
+            }
+            trace::Scope sc("overlay", frame_id_);
+            tracker_->drawOverlay(frame_bgr, T_cw, arena_.resource());
+        });
+        {
+            trace::Scope sc("pool_wait", frame_id_);
+            frame_tasks.wait();
+        }
+        latency_.add(glass_ns, trace::nowNs());
+        if (session_)
+            session_->pushPose(frame_id_, T_cw, last_by_markers_ ? PoseSource::Markers
+                                                                 : PoseSource::Slam);
+        housekeeper_->tick(frame_id_, ts, *tracker_);
+
+        // ------ показ: HighGUI — только из потока, создавшего окно ------
+        {
+            trace::Scope sc("display", frame_id_);
+            cv::imshow(kWin, frame_bgr);
         }
 
-        // ------ overlay ------
-        drawOverlay(frame_bgr, T_cw);
-        cv::imshow(kWin, frame_bgr);
+        // ------ запись: кадр уходит в очередь по ссылке ------
+        if (recorder_) {
+            trace::Scope sc("record", frame_id_);
+            recorder_->push(frame_bgr);
+            frame_bgr.release();   // следующий захват не перепишет кадр в очереди
+        }
 
         // ------ hotkeys ------
         int key = cv::waitKey(1) & 0xFF;
         if (key == 27) break;             // ESC
-        handleHotkey(key, frame_rgb, ts);
+        handleHotkey(key, ts);
+
+        // ------ конец кадра: арена + отчёт об аллокациях ------
+        arena_.reset();
+        if constexpr (util::allocCountingEnabled()) {
+            // главный поток + задачи кадра в пуле (все уже дождались)
+            const auto m = allocs.delta();
+            const auto t = frame_allocs_.take();
+            if (m.count + t.count > 0) {
+                std::cout << "[alloc] frame " << frame_id_ << ": "
+                          << m.count + t.count << " allocs, " << m.bytes + t.bytes
+                          << " B (pool tasks " << t.count << ")\n";
+            }
+        }
+        if (arena_.spilledBytes() > 0) {                  // итог — в reportLatency()
+            ++arena_spill_frames_;
+            arena_spill_peak_ = std::max(arena_spill_peak_, arena_.spilledBytes());
+        }
+        ++frame_id_;
+        if (p_.latency_report_every > 0 &&
+            frame_id_ % static_cast<std::uint64_t>(p_.latency_report_every) == 0) {
+            reportLatency();
+        }
+    }
+
+    // ------ итог записи и трассировки ------
+    if (recorder_) {
+        recorder_->stop();
+        const auto st = recorder_->stats();
+        std::cout << "[record] written " << st.written << " / " << st.pushed
+                  << " frames, dropped " << st.dropped
+                  << " (queue peak " << st.queue_hwm << ")\n";
+    }
+    if (session_) {
+        session_->stop();
+        const auto st = session_->stats();
+        std::cout << "[session] " << st.frames << " frames, dropped " << st.dropped
+                  << ", " << st.stored_bytes / (1 << 20) << " / "
+                  << st.raw_bytes / (1 << 20) << " MiB stored, "
+                  << st.compressed << " images compressed\n";
+    }
+    if (gate_) std::cout << "[gate] skipped " << gate_->skipped() << " static frames\n";
+    if (p_.marker_odometry)
+        std::cout << "[odo] " << odo_frames_ << " frames posed by markers, "
+                  << odo_slam_ << " of them fed to SLAM\n";
+    reportLatency();
+    if (!p_.trace_path.empty()) {
+        if (trace::Tracer::instance().dumpChromeJson(p_.trace_path))
+            std::cout << "[trace] written " << p_.trace_path << "\n";
+        else
+            std::cerr << "[trace] cannot write " << p_.trace_path << "\n";
     }
 }
 
 //-------------------------------------------------------------
 // private helpers
 //-------------------------------------------------------------
-void App::handleHotkey(int key, const cv::Mat& frame_rgb, double ts) {
+App::FrameStep App::processFrame(const cv::Mat& frame_bgr, double ts,
+                                 TaskPool::Group& side) {
+    const bool auto_scan = p_.qr_scan_enable && p_.qr_scan_interval > 0 &&
+        frame_id_ % static_cast<std::uint64_t>(p_.qr_scan_interval) == 0;
+
+    // одометрия по маркерам: по прошлой позе в кадре ≥ min_markers слитых
+    // маркеров → QR + joint PnP вместо SLAM
+    const bool odo_try = p_.marker_odometry && !need_scan_ &&
+        tracker_->numFusedInView(last_T_cw_, frame_bgr.cols, frame_bgr.rows, p_.odo.min_obs) >=
+            static_cast<std::size_t>(std::max(1, p_.odo.min_markers));
+    const bool scan = need_scan_ || auto_scan || odo_try;
+    // ждать PnP до SLAM стоит, только если она, скорее всего, удастся (прошлая
+    // попытка удалась): иначе SLAM идёт параллельно с QR, как без одометрии,
+    // и провал PnP не добавляет время детекции к кадру
+    const bool odo_first = odo_try && odo_last_ok_;
+
+    // серый кадр, поиск QR и PnP одометрии — в пуле, параллельно с
+    // трекингом SLAM; поза для регистрации нужна только после обоих
+    std::optional<Eigen::Matrix4d> T_odo;
+    side.run([this, &frame_bgr, scan, odo_try, &T_odo] {
+        util::TaskAllocProbe allocs(frame_allocs_);
+        {
+            trace::Scope sc("convert_gray", frame_id_);
+            cv::cvtColor(frame_bgr, frame_gray_, cv::COLOR_BGR2GRAY);
+        }
+        if (scan) detectMarkers(frame_gray_);
+        if (odo_try) {
+            trace::Scope sc("marker_odo", frame_id_);
+            T_odo = tracker_->poseFromMarkers(dets_, last_T_cw_, p_.odo);
+        }
+    });
+
+    FrameStep step;
+    if (odo_first) {
+        {
+            trace::Scope sc("pool_wait", frame_id_);
+            side.wait();
+        }
+        if (T_odo) {
+            step.T_cw       = *T_odo;
+            step.by_markers = true;
+            ++odo_frames_;
+        }
+    }
+
+    // на кадрах одометрии SLAM получает лишь каждый N-й кадр (его поза не
+    // используется) — чтобы не потерять трекинг при выходе из зоны маркеров
+    const bool feed = !step.by_markers ||
+        (p_.odo_slam_every > 0 && odo_frames_ % static_cast<std::uint64_t>(p_.odo_slam_every) == 0);
+    if (feed) {
+        // буферы-члены: после первого кадра cvtColor не перевыделяет память
+        {
+            trace::Scope sc("convert", frame_id_);
+            cv::cvtColor(frame_bgr, frame_rgb_, cv::COLOR_BGR2RGB);
+        }
+
+        // ------ SLAM ------
+        trace::Scope sc("slam", frame_id_);
+        const Eigen::Matrix4d T_slam = rgbd_ ? slam_->feed_RGBD_frame(frame_rgb_, depth_, ts)
+                                             : slam_->feed_monocular_frame(frame_rgb_, ts);
+        if (step.by_markers) ++odo_slam_;
+        else                 step.T_cw = T_slam;
+    }
+    {
+        trace::Scope sc("pool_wait", frame_id_);
+        side.wait();
+    }
+    // PnP шла параллельно с SLAM: удалась — поза кадра всё равно по маркерам
+    // (SLAM уже получил кадр), и следующий кадр снова ждёт PnP первой
+    if (odo_try && !odo_first && T_odo) {
+        step.T_cw       = *T_odo;
+        step.by_markers = true;
+        ++odo_frames_;
+        ++odo_slam_;
+    }
+    if (odo_try) odo_last_ok_ = T_odo.has_value();
+
+    // ------ карта сдвинулась? (конец loop BA или периодически) ------
+    // (в режиме локализации карта неподвижна — проверять нечего)
+    if (!p_.localization) {
+        const bool loop_ba = slam_->loop_BA_is_running();
+        const bool periodic = p_.anchor_refresh_frames > 0 &&
+            frame_id_ % static_cast<std::uint64_t>(p_.anchor_refresh_frames) == 0;
+        if ((loop_ba_running_ && !loop_ba) || periodic) notifyMapChanged();
+        loop_ba_running_ = loop_ba;
+    }
+
+    // ------ первичный / ручной / периодический скан ------
+    // регистрирует задача пула (run); поза по маркерам не уточняет сами
+    // маркеры (замкнутый круг) — регистрируются только новые
+    // в лог сессии — каждая детекция, и кадров одометрии тоже
+    // (pushFrame этого кадра в той же группе — уже выполнен)
+    if (scan) {
+        if (session_) session_->pushDetections(frame_id_, dets_);
+        tracker_->markSeen(dets_, ts);
+    }
+    step.register_dets = need_scan_ || auto_scan;
+    return step;
+}
+
+void App::handleHotkey(int key, double /*ts*/) {
     switch (key) {
-        case ' ': case 's': {                         // manual scan
-            cv::Mat frame_gray;
-            cv::cvtColor(frame_rgb, frame_gray, cv::COLOR_RGB2GRAY);
-            Eigen::Matrix4d T_cw = slam_->get_map_database()->get_current_cam_pose();
-            detectAndRegisterMarkers(frame_gray, frame_rgb, T_cw);
+        case ' ': case 's':                           // manual scan
+            // скан — на следующем кадре: гейт его не пропустит, серый кадр
+            // и поза будут свежими (frame_gray_ при стоящем гейте устарел)
+            need_scan_ = true;
             break;
-        }
         case 'r': {                                   // reset
-            markers_.clear();
+            if (p_.localization) {                    // reset() стёр бы карту
+                std::cout << "[INFO] reset disabled in localization mode\n";
+                break;
+            }
+            tracker_->clear();
             slam_->reset();
+            if (gate_) gate_->reset();
             need_scan_ = true;
             std::cout << "[INFO] reset\n";
             break;
@@ -104,95 +509,98 @@ void App::handleHotkey(int key, const cv::Mat& frame_rgb, double ts) {
     }
 }
 
-void App::detectAndRegisterMarkers(const cv::Mat& frame_gray,
-                                   const cv::Mat& frame_rgb,
-                                   const Eigen::Matrix4d& T_cw) {
-    std::vector<cv::Point>       pts;
-    std::vector<cv::Point2f>     corners;
-    std::vector<std::string>     datas;
+void App::detectMarkers(const cv::Mat& frame_gray) {
+    trace::Scope sc("qr_detect", frame_id_);
+    qrdet_->detect(frame_gray, dets_);            // dets_ переиспользуется
+}
 
-    bool ok = qrdet_.detectAndDecodeMulti(frame_gray, datas, corners, pts);
-    if (!ok || datas.empty()) {
-        std::cout << "[scan] none\n";
+void App::registerMarkers(const Eigen::Matrix4d& T_cw, bool verbose, bool only_new) {
+    if (only_new) {
+        dets_.erase(std::remove_if(dets_.begin(), dets_.end(),
+                                   [this](const QrDetection& d) { return tracker_->contains(d.id); }),
+                    dets_.end());
+        if (dets_.empty()) return;
+    }
+    if (dets_.empty()) {
+        if (verbose) std::cout << "[scan] none\n";
         need_scan_ = false;
         return;
     }
 
-    // развернём в векторы по 4 угла
-    size_t num = datas.size();
-    for (size_t i = 0; i < num; ++i) {
-        std::string id = datas[i];
-        if (id.empty()) continue;
-
-        // corners come as Nx4, contiguous
-        cv::Point2f c2d[4];
-        std::copy_n(&corners[i*4], 4, c2d);
-
-        // --- solvePnP ---
-        const double s = p_.marker_size;
-        std::vector<cv::Point3f> obj{
-            {-s/2, -s/2, 0},  {s/2, -s/2, 0},
-            {s/2,  s/2, 0},  {-s/2,  s/2, 0}
-        };
-        cv::Mat rvec, tvec;
-        cv::Mat K = (cv::Mat_<double>(3,3) <<
-                     cfg_->camera_->fx_, 0, cfg_->camera_->cx_,
-                     0, cfg_->camera_->fy_, cfg_->camera_->cy_,
-                     0, 0, 1);
-        cv::solvePnP(obj, std::vector<cv::Point2f>(c2d, c2d+4),
-                     K, cv::Mat(), rvec, tvec, false,
-                     cv::SOLVEPNP_ITERATIVE);
-
-        cv::Mat Rcv;
-        cv::Rodrigues(rvec, Rcv);
-        Eigen::Matrix3d R_cm;
-        Eigen::Vector3d t_cm;
-        cv::cv2eigen(Rcv, R_cm);
-        cv::cv2eigen(tvec, t_cm);
-
-        // --- мировая поза маркера ---
-        Eigen::Matrix3d R_wc = T_cw.block<3,3>(0,0).transpose();
-        Eigen::Vector3d t_wc = -R_wc * T_cw.block<3,1>(0,3);
-
-        Eigen::Matrix3d R_wm = R_wc * R_cm;
-        Eigen::Vector3d t_wm = R_wc * t_cm + t_wc;
-
-        markers_[id] = MarkerPose{id, t_wm, R_wm};
-        std::cout << "[scan] +" << id << "\n";
+    if (tracker_->readOnly()) {                   // локализация: карта маркеров готова
+        need_scan_ = false;
+        return;
     }
+
+    trace::Scope sc("pnp", frame_id_);
+    const auto anchor = anchorKeyframe();
+    const auto* anc   = anchor ? &*anchor : nullptr;
+    if (rgbd_)
+        tracker_->addDetectionsRgbd(dets_, depth_, depth_factor_, T_cw,
+                                    p_.marker_size, anc);   // плоскость по глубине
+    else
+        tracker_->addDetections(dets_, T_cw, p_.marker_size, anc);   // PnP
     need_scan_ = false;
 }
 
-void App::drawOverlay(cv::Mat& frame_rgb,
-                      const Eigen::Matrix4d& T_cw) const {
-    if (markers_.empty()) return;
-
-    // параметры камеры
-    const auto& cam = cfg_->camera_;
-    cv::Mat K = (cv::Mat_<double>(3,3) <<
-                 cam->fx_, 0, cam->cx_,
-                 0, cam->fy_, cam->cy_,
-                 0, 0, 1);
-
-    Eigen::Matrix3d R_wc = T_cw.block<3,3>(0,0).transpose();
-    Eigen::Vector3d t_wc = -R_wc * T_cw.block<3,1>(0,3);
-
-    for (const auto& [id, mk] : markers_) {
-        // вектор от камеры к маркеру
-        Eigen::Vector3d p_c = R_wc * (mk.t_w - t_wc);
-
-        if (p_c.z() <= 0.1) continue; // за камерой ← не рисуем
+std::optional<MarkerTracker::KeyframeAnchor> App::anchorKeyframe() const {
+    // последний вставленный кейфрейм: O(1) и без обхода карты; трекинг
+    // вставляет кейфрейм, как только сцена уходит от опорного, поэтому он
+    // видел ту же сцену, что и текущий кадр
+    const auto kf = slam_->get_map_database()->get_last_inserted_keyframe();
+    if (!kf || kf->will_be_erased()) return std::nullopt;
+    return MarkerTracker::KeyframeAnchor{static_cast<std::uint64_t>(kf->id_), kf->get_cam_pose()};
+}
 
-        // проектируем центр
-        cv::Point2d uv(
-            (cam->fx_ * p_c.x()) / p_c.z() + cam->cx_,
-            (cam->fy_ * p_c.y()) / p_c.z() + cam->cy_);
+void App::notifyMapChanged() {
+    if (tracker_->numAnchors() == 0) return;
+
+    // трекер спрашивает только id своих якорей, по одному, и только при
+    // следующем чтении поз маркеров — обхода всех кейфреймов нет
+    auto map_db = slam_->get_map_database();     // указатель или shared_ptr
+    tracker_->markMapChanged(
+        [map_db](std::uint64_t id) -> std::optional<Eigen::Matrix4d> {
+            const auto kf = map_db->get_keyframe(static_cast<unsigned int>(id));
+            if (!kf || kf->will_be_erased()) return std::nullopt;
+            return kf->get_cam_pose();
+        });
+}
 
-        cv::Scalar col = {0, 255, 0};
-        cv::circle(frame_rgb, uv, 6, col, 2, cv::LINE_AA);
-        cv::putText(frame_rgb, id, uv + cv::Point2d(8, -8),
-                    cv::FONT_HERSHEY_SIMPLEX, .6, {255,0,0}, 2, cv::LINE_AA);
+void App::saveMaps() {
+    // вызывается после shutdown(): финальный global BA уже применён
+    try {
+        if (!p_.map_path.empty()) {
+            if (slam_->save_map_database(p_.map_path))
+                std::cout << "[map] saved " << p_.map_path << "\n";
+            else
+                std::cerr << "[map] cannot save " << p_.map_path << "\n";
+        }
+        if (!p_.marker_db_path.empty()) {
+            notifyMapChanged();                   // привязки — к итоговым позам
+            tracker_->save(p_.marker_db_path);
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "[map] save failed: " << ex.what() << "\n";
     }
 }
 
+void App::reportLatency() const {
+    if (latency_.count() == 0) return;
+    std::cout << std::fixed << std::setprecision(1)
+              << "[latency] glass->overlay  n=" << latency_.count()
+              << "  mean=" << latency_.mean() << " ms"
+              << "  p50="  << latency_.percentile(0.50)
+              << "  p99="  << latency_.percentile(0.99)
+              << "  max="  << latency_.max() << " ms\n";
+
+    if (arena_spill_frames_ > 0)
+        std::cout << "[arena] " << arena_spill_frames_ << " frames spilled to heap, peak "
+                  << arena_spill_peak_ << " B (capacity " << arena_.capacity() << " B)\n";
+
+    const auto st = pool_->stats();
+    std::cout << "[pool] queued=" << st.queued << "  peak=" << st.queue_hwm
+              << "  tasks=" << st.executed << "  stolen=" << st.stolen
+              << "  helped=" << st.helped << "\n";
+}
+
 } // namespace qrslam
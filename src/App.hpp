@@ -9,11 +9,25 @@
 #include <string>
 #include <unordered_map>
 #include <optional>
+#include <vector>
+#include <array>
+#include <cstdint>
 
 #include <Eigen/Core>
 #include <opencv2/core.hpp>
 #include <opencv2/videoio.hpp>
-#include <opencv2/objdetect.hpp>
+
+#include "MapHousekeeper.hpp"
+#include "MarkerTracker.hpp"
+#include "MotionGate.hpp"
+#include "QrDetector.hpp"
+#include "RgbdDataset.hpp"
+#include "SessionLog.hpp"
+#include "TaskPool.hpp"
+#include "VideoRecorder.hpp"
+#include "utils/AllocCounter.hpp"
+#include "utils/FrameArena.hpp"
+#include "utils/Trace.hpp"
 
 namespace openvslam {
 class system;
@@ -26,12 +40,6 @@ namespace qrslam {
 //
 // Структуры данных
 //
-struct MarkerPose {
-    std::string id;             ///< Декодированная строка из QR-кода
-    Eigen::Vector3d t_w;        ///< Центр маркера в мировой СК (метры)
-    Eigen::Matrix3d R_w;        ///< Ориентация маркера (опц.)
-};
-
 struct AppParams {
     std::string config_path;    ///< openvslam config.yaml
     std::string vocab_path;     ///< ORB словарь .fbow
@@ -40,8 +48,34 @@ struct AppParams {
     int         height   = 720;
     double      cam_fps  = 60.0;
     double      marker_size = 0.040; ///< физический размер QR-кода (м)
+    bool        qr_scan_enable   = true;     ///< автоскан каждые N кадров
+    int         qr_scan_interval = 2;        ///< N (qr_scan.interval_frame)
+    std::string qr_detector      = "opencv"; ///< бэкенд, см. QrDetector.hpp
+    int         anchor_refresh_frames = 30;  ///< проверка кейфреймов-якорей маркеров
+    bool        marker_odometry = false; ///< поза по маркерам вместо SLAM, где их видно
+    MarkerTracker::JointPnpParams odo;   ///< условия (marker_odometry.*)
+    int         odo_slam_every  = 5;     ///< SLAM на кадрах одометрии: каждый N-й (0 = нет)
+    bool        motion_gate = false;     ///< пропуск SLAM/QR на статичных кадрах
+    MotionGate::Params gate;             ///< пороги гейта (motion_gate.*)
+    bool        localization = false;    ///< только трекинг по готовой карте (map.mode)
+    std::string map_path;            ///< карта SLAM: localization — загрузка, slam — сохранение
+    std::string marker_db_path;      ///< база маркеров, так же
+    std::string rgbd_dataset;        ///< каталог RGB-D набора (Camera.setup: RGBD)
+    VideoRecorder::Params record;    ///< запись overlay; path пуст = выкл.
+    SessionWriter::Params session;   ///< лог сырой сессии; path пуст = выкл.
+    MapHousekeeper::Params growth;   ///< телеметрия и лимиты роста (map_growth.*)
+    TaskPool::Params pool;           ///< пул не-SLAM задач (threads.pool_*)
+    std::vector<int> slam_cpus;      ///< ядра tracking/mapping/loop closing; пусто = все
+    int         opencv_threads = -1; ///< cv::setNumThreads; < 0 — не менять
+    std::size_t frame_arena_bytes = 256 * 1024; ///< размер кадровой арены
+    std::string trace_path;          ///< Chrome-trace JSON; пусто = выкл.
+    int         latency_report_every = 300;  ///< кадров между отчётами
 };
 
+/// Прочитать app.yaml поверх значений по умолчанию
+/// (config_path / vocab_path задаются отдельно, из командной строки).
+AppParams loadAppParams(const std::string& app_yaml_path);
+
 //-------------------------------------------------------------
 //
 // Класс приложения
@@ -55,13 +89,25 @@ public:
     void run();
 
 private:
+    /// итог SLAM-части кадра; регистрация детекций идёт задачей пула
+    struct FrameStep {
+        Eigen::Matrix4d T_cw;
+        bool            register_dets = false;   // скан: dets_ → карта маркеров
+        bool            by_markers    = false;   // поза — одометрия по маркерам:
+                                                 // регистрируются только новые
+    };
+
     // — внутренние сервисы —
-    void handleHotkey(int key, const cv::Mat& frame_rgb, double timestamp);
-    void detectAndRegisterMarkers(const cv::Mat& frame_gray,
-                                  const cv::Mat& frame_rgb,
-                                  const Eigen::Matrix4d& T_cw);           // PnP
-    void drawOverlay(cv::Mat& frame_rgb,
-                     const Eigen::Matrix4d& T_cw) const;                 // UI
+    FrameStep processFrame(const cv::Mat& frame_bgr, double ts,
+                           TaskPool::Group& side);                       // SLAM + QR
+    void handleHotkey(int key, double timestamp);
+    void detectMarkers(const cv::Mat& frame_gray);                       // QR (в пуле)
+    void registerMarkers(const Eigen::Matrix4d& T_cw, bool verbose,
+                         bool only_new = false);                         // PnP
+    void reportLatency() const;                                          // trace + пул
+    std::optional<MarkerTracker::KeyframeAnchor> anchorKeyframe() const;  // якорь
+    void notifyMapChanged();                                             // BA / loop
+    void saveMaps();                                                     // map.path
 
     // — поля —
     AppParams                               p_;
@@ -69,10 +115,35 @@ private:
     std::unique_ptr<openvslam::system>      slam_;
 
     cv::VideoCapture                        cap_;
-    cv::QRCodeDetector                      qrdet_;
+    std::unique_ptr<RgbdDataset>            dataset_;     // RGB-D: источник кадров
+    bool                                    rgbd_         = false;
+    double                                  depth_factor_ = 1.0;  // raw → метры
+    std::unique_ptr<QrDetector>             qrdet_;       // по qr_scan.detector
+    std::unique_ptr<MarkerTracker>          tracker_;     // карта маркеров
+    std::unique_ptr<VideoRecorder>          recorder_;    // overlay → файл (опц.)
+    std::unique_ptr<SessionWriter>          session_;     // сырые кадры + позы (опц.)
+    std::unique_ptr<MotionGate>             gate_;        // статичная сцена → пропуск
+    std::unique_ptr<TaskPool>               pool_;        // вся не-SLAM работа
+    std::unique_ptr<MapHousekeeper>         housekeeper_; // телеметрия + лимиты роста
+
+    // — переиспользуемые буферы горячего пути (ёмкость сохраняется) —
+    cv::Mat                                 frame_rgb_, frame_gray_, depth_;
+    std::vector<QrDetection>                dets_;
+    util::FrameArena                        arena_;       // сброс в конце кадра
+    util::FrameAllocTally                   frame_allocs_;  // аллокации задач кадра в пуле
+    std::uint64_t                           arena_spill_frames_ = 0;  // кадров с выходом в кучу
+    std::uint64_t                           arena_spill_peak_   = 0;  // max байт за кадр
+    std::uint64_t                           frame_id_    = 0;
+    trace::LatencyStats                     latency_;     // glass → overlay
+    Eigen::Matrix4d                         last_T_cw_   = Eigen::Matrix4d::Identity();
+    bool                                    gate_idle_   = false;
+    bool                                    last_by_markers_ = false;  // источник last_T_cw_
+    bool                                    odo_last_ok_ = true;   // прошлая попытка одометрии
+    std::uint64_t                           odo_frames_  = 0;   // поза по маркерам
+    std::uint64_t                           odo_slam_    = 0;   // …из них поданы в SLAM
 
-    std::unordered_map<std::string, MarkerPose> markers_;  // карта маркеров
     bool                                     need_scan_   = true;  // стартовая инициализация
+    bool                                     loop_ba_running_ = false;
 };
 
 } // namespace qrslam
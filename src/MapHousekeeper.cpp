@@ -0,0 +1,159 @@
+/**
+ * @file   MapHousekeeper.cpp
+ */
+#include "MapHousekeeper.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_set>
+
+#include <unistd.h>
+
+#include <openvslam/system.h>
+#include <openvslam/data/keyframe.h>
+#include <openvslam/data/landmark.h>
+#include <openvslam/data/map_database.h>
+
+#include <spdlog/spdlog.h>
+
+#include "MarkerTracker.hpp"
+
+namespace qrslam {
+
+namespace {
+
+// Оценки памяти структур openvslam (ORB, 32-байтные дескрипторы):
+// на ключевую точку — cv::KeyPoint ×2 (сырая и неискажённая), дескриптор,
+// bearing (3×double), указатель на ландмарку, слово BoW; плюс постоянная
+// часть кейфрейма (позы, граф ковидимости, сетка точек).
+constexpr std::size_t kKeyframeFixed  = 4096;
+constexpr std::size_t kPerKeypoint    = 2 * 28 + 32 + 3 * 8 + 8 + 16;
+// ландмарка: объект + дескриптор + узлы карты наблюдений (~4)
+constexpr std::size_t kLandmarkBytes  = 320 + 4 * 48;
+
+// свежие кейфреймы ещё обрабатывает local mapping
+constexpr std::uint64_t kRecentKeyframes = 20;
+
+} // namespace
+
+MapHousekeeper::MapHousekeeper(const Params& p, openvslam::system& slam,
+                               TaskPool& pool, bool allow_cull)
+    : p_{p}, slam_{slam}, allow_cull_{allow_cull}, group_{pool} {}
+
+std::size_t MapHousekeeper::residentBytes() {
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0, resident = 0;
+    const int n = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    if (n != 2) return 0;
+    return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+MapHousekeeper::Telemetry MapHousekeeper::last() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return last_;
+}
+
+// ---------------------------------------------------------------------
+// главный поток
+// ---------------------------------------------------------------------
+void MapHousekeeper::tick(std::uint64_t frame_id, double ts, MarkerTracker& tracker) {
+    if (p_.period_frames <= 0 || frame_id % static_cast<std::uint64_t>(p_.period_frames) != 0)
+        return;
+    if (busy_.load(std::memory_order_acquire)) return;   // прошлый шаг ещё идёт
+
+    if (p_.marker_max_age_h > 0.0)
+        evicted_ += tracker.evictUnseen(ts - p_.marker_max_age_h * 3600.0);
+
+    busy_.store(true, std::memory_order_release);
+    group_.run([this, anchors = tracker.anchorIds(), n = tracker.size(),
+                bytes = tracker.memoryBytes()]() mutable {
+        step(std::move(anchors), n, bytes);
+        busy_.store(false, std::memory_order_release);
+    });
+}
+
+// ---------------------------------------------------------------------
+// пул
+// ---------------------------------------------------------------------
+void MapHousekeeper::step(std::vector<std::uint64_t> anchors, std::size_t markers,
+                          std::size_t marker_bytes) {
+    auto map_db = slam_.get_map_database();
+    auto kfs    = map_db->get_all_keyframes();
+
+    // --- прореживание: порция кейфреймов после курсора ----------------
+    std::uint64_t culled = 0;
+    const std::size_t live = static_cast<std::size_t>(std::count_if(
+        kfs.begin(), kfs.end(), [](const auto& kf) { return kf && !kf->will_be_erased(); }));
+    if (allow_cull_ && p_.max_keyframes > 0 && live > p_.max_keyframes &&
+        !slam_.loop_BA_is_running()) {
+        std::sort(kfs.begin(), kfs.end(),
+                  [](const auto& a, const auto& b) { return a->id_ < b->id_; });
+        const std::uint64_t max_id = kfs.empty() ? 0 : static_cast<std::uint64_t>(kfs.back()->id_);
+        const std::unordered_set<std::uint64_t> pinned(anchors.begin(), anchors.end());
+
+        auto first = std::lower_bound(kfs.begin(), kfs.end(), cursor_,
+                                      [](const auto& kf, std::uint64_t id) {
+                                          return static_cast<std::uint64_t>(kf->id_) < id;
+                                      });
+        if (first == kfs.end()) first = kfs.begin();  // круг замкнулся
+
+        // публичный API: local mapping на паузе (ждёт точки паузы), трекинг
+        // не вставляет кейфреймы — кейфреймы помечает только этот цикл
+        slam_.disable_mapping_module();
+        int checked = 0;
+        for (auto it = first; it != kfs.end() && checked < p_.cull_batch; ++it, ++checked) {
+            const auto& kf = *it;
+            const auto  id = static_cast<std::uint64_t>(kf->id_);
+            cursor_ = id + 1;
+            if (live - culled <= p_.max_keyframes) break;
+            if (kf->will_be_erased() || id == 0 || id + kRecentKeyframes > max_id ||
+                pinned.count(id))
+                continue;
+
+            std::size_t valid = 0, redundant = 0;
+            for (const auto& lm : kf->get_landmarks()) {
+                if (!lm || lm->will_be_erased()) continue;
+                ++valid;
+                // кейфреймы-наблюдатели, а не num_observations(): тот считает
+                // стерео / RGB-D наблюдение дважды и удвоил бы «избыточность»
+                if (lm->get_observations().size() > static_cast<std::size_t>(p_.min_observers))
+                    ++redundant;
+            }
+            if (valid > 0 && redundant >= p_.redundant_ratio * valid) {
+                kf->prepare_for_erasing();
+                ++culled;
+            }
+        }
+        slam_.enable_mapping_module();
+    }
+
+    // --- телеметрия ------------------------------------------------------
+    Telemetry t;
+    std::size_t keypoints = 0;
+    for (const auto& kf : kfs)
+        if (kf && !kf->will_be_erased()) keypoints += kf->num_keypoints_;
+    t.rss_bytes       = residentBytes();
+    t.keyframes       = live - culled;
+    t.landmarks       = map_db->get_num_landmarks();
+    t.markers         = markers;
+    t.keyframe_bytes  = t.keyframes * kKeyframeFixed + keypoints * kPerKeypoint;
+    t.landmark_bytes  = t.landmarks * kLandmarkBytes;
+    t.marker_bytes    = marker_bytes;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        t.culled_keyframes = last_.culled_keyframes + culled;
+        t.evicted_markers  = evicted_;
+        last_ = t;
+    }
+
+    constexpr double kMiB = 1.0 / (1 << 20);
+    spdlog::info("[map] rss {:.1f} MiB | keyframes {} (~{:.1f} MiB) | landmarks {} (~{:.1f} MiB)"
+                 " | markers {} (~{:.1f} KiB) | culled {} kf, evicted {} markers",
+                 t.rss_bytes * kMiB, t.keyframes, t.keyframe_bytes * kMiB,
+                 t.landmarks, t.landmark_bytes * kMiB,
+                 t.markers, t.marker_bytes / 1024.0, t.culled_keyframes, t.evicted_markers);
+}
+
+} // namespace qrslam
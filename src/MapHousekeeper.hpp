@@ -0,0 +1,98 @@
+#pragma once
+/**
+ * @file   MapHousekeeper.hpp
+ * @brief  Телеметрия памяти и роста карты + политики, ограничивающие рост
+ *         (прореживание избыточных кейфреймов, вытеснение старых маркеров).
+ *
+ *  tick() вызывается из цикла кадров и никогда не ждёт: раз в period_frames
+ *  на главном потоке вытесняются давно не виденные маркеры (O(маркеров),
+ *  MarkerTracker однопоточный), а тяжёлая часть — обход кейфреймов, оценка
+ *  памяти, прореживание — уходит задачей в TaskPool. Пока задача не
+ *  закончилась, следующая не ставится.
+ *
+ *  Прореживание — критерий local mapping openvslam: кейфрейм избыточен,
+ *  если ≥ redundant_ratio его ландмарок видны ещё хотя бы min_observers
+ *  кейфреймами. Local mapping применяет его лишь к соседям нового
+ *  кейфрейма; здесь — ко всей карте, порциями по cull_batch кейфреймов
+ *  (курсор по id по кругу). На время порции local mapping выключен через
+ *  system::disable_mapping_module() / enable_mapping_module(), так что его
+ *  собственная чистка не идёт параллельно; трекинг (цикл кадров) работает,
+ *  но новых кейфреймов не вставляет, а ещё не обработанные openvslam при
+ *  паузе отбрасывает. Не трогаются: первый кейфрейм, свежие кейфреймы
+ *  и якоря маркеров.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "TaskPool.hpp"
+
+namespace openvslam {
+class system;
+} // namespace openvslam
+
+namespace qrslam {
+
+class MarkerTracker;
+
+class MapHousekeeper {
+public:
+    struct Params {
+        int         period_frames    = 300;   ///< шаг телеметрии/политик, кадров (0 = выкл.)
+        std::size_t max_keyframes    = 0;     ///< > 0 — прореживать сверх лимита
+        int         cull_batch       = 50;    ///< кейфреймов проверяется за шаг
+        double      redundant_ratio  = 0.9;   ///< доля «чужих» ландмарок
+        int         min_observers    = 3;     ///< других кейфреймов на ландмарку
+        double      marker_max_age_h = 0.0;   ///< > 0 — забывать маркеры старше, ч
+    };
+
+    /// Последний снимок; байты структур SLAM — оценки, см. MapHousekeeper.cpp.
+    struct Telemetry {
+        std::size_t   rss_bytes       = 0;
+        std::size_t   keyframes       = 0;
+        std::size_t   landmarks       = 0;
+        std::size_t   markers         = 0;
+        std::size_t   keyframe_bytes  = 0;
+        std::size_t   landmark_bytes  = 0;
+        std::size_t   marker_bytes    = 0;
+        std::uint64_t culled_keyframes = 0;   ///< всего за сессию
+        std::uint64_t evicted_markers  = 0;
+    };
+
+    /// @param allow_cull  false — карта неизменна (режим локализации)
+    MapHousekeeper(const Params& p, openvslam::system& slam, TaskPool& pool, bool allow_cull);
+    ~MapHousekeeper() = default;              // group_ дожидается задачи
+
+    MapHousekeeper(const MapHousekeeper&)            = delete;
+    MapHousekeeper& operator=(const MapHousekeeper&) = delete;
+
+    /// Из цикла кадров (главный поток). @param ts  метка времени кадра, с
+    void tick(std::uint64_t frame_id, double ts, MarkerTracker& tracker);
+
+    Telemetry last() const;
+
+    /// RSS процесса, байт (/proc/self/statm; 0 — недоступно)
+    static std::size_t residentBytes();
+
+private:
+    void step(std::vector<std::uint64_t> anchors, std::size_t markers,
+              std::size_t marker_bytes);      // в пуле
+
+    Params             p_;
+    openvslam::system& slam_;
+    bool               allow_cull_;
+    std::uint64_t      cursor_  = 0;          // следующий id для проверки (только step)
+    std::uint64_t      evicted_ = 0;          // пишет tick(), пока step() не идёт
+
+    mutable std::mutex m_;
+    Telemetry          last_;
+
+    std::atomic<bool>  busy_{false};
+    TaskPool::Group    group_;                // последним: ждёт step() в деструкторе
+};
+
+} // namespace qrslam
@@ -8,43 +8,66 @@
 #include <opencv2/core/eigen.hpp>
 #include <spdlog/spdlog.h>
 
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+
+#include "utils/Geometry.hpp"
+
 namespace qrslam {
 
 // ---------------------------------------------------------------------
 // ctor
 // ---------------------------------------------------------------------
-MarkerTracker::MarkerTracker(const CameraIntrinsics& K) : K_{K} {}
+MarkerTracker::MarkerTracker(const CameraIntrinsics& K)
+    : K_{K},
+      Kcv_{K.fx, 0,    K.cx,
+           0,    K.fy, K.cy,
+           0,    0,    1},
+      cam_{geom::Pinhole{K.fx, K.fy, K.cx, K.cy}} {}
+
+void MarkerTracker::setCameraModel(geom::CameraModel cam) {
+    cam_ = std::move(cam);
+    spdlog::info("[MarkerTracker] camera model: {}", geom::cameraModelName(cam_));
+}
+
+void MarkerTracker::toIdealPx(const cv::Point2f* px, std::size_t n, cv::Point2f* out) const {
+    geom::unprojectBatch(cam_, px, n, out);
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = {float(K_.fx * out[i].x + K_.cx), float(K_.fy * out[i].y + K_.cy)};
+}
 
 // ---------------------------------------------------------------------
 // public
 // ---------------------------------------------------------------------
 void MarkerTracker::addDetections(const std::vector<QrDetection>& dets,
                                   const Eigen::Matrix4d& T_cw,
-                                  double marker_size) {
-    if (dets.empty()) return;
+                                  double marker_size,
+                                  const KeyframeAnchor* anchor) {
+    if (dets.empty() || read_only_) return;
+    syncAnchors();   // не смешивать свежие позы с устаревшим кэшем
 
     // Camera pose world<-camera
     Eigen::Matrix4d T_wc = T_cw.inverse();
     Eigen::Matrix3d R_wc = T_wc.block<3,3>(0,0);
     Eigen::Vector3d t_wc = T_wc.block<3,1>(0,3);
 
-    // intrinsics
-    cv::Mat Kcv = (cv::Mat_<double>(3,3) <<
-                   K_.fx, 0,     K_.cx,
-                   0,     K_.fy, K_.cy,
-                   0,     0,     1);
-
-    const double s = marker_size;
-    std::vector<cv::Point3f> obj{
+    // объектные точки и выходы PnP — на стеке, без аллокаций
+    const float s = static_cast<float>(marker_size);
+    const std::array<cv::Point3f,4> obj{{
         {-s/2,-s/2,0}, { s/2,-s/2,0},
         { s/2, s/2,0}, {-s/2, s/2,0}
-    };
+    }};
+    const cv::Mat obj_m(4, 1, CV_32FC3, const_cast<cv::Point3f*>(obj.data()));
+
+    std::array<cv::Point2f,4> img;      // углы в пикселях идеального пинхола
+    const cv::Mat img_m(4, 1, CV_32FC2, img.data());
 
     for (const auto& d : dets) {
-        std::vector<cv::Point2f> img_pts(d.corners_px.begin(),
-                                         d.corners_px.end());
-        cv::Mat rvec, tvec;
-        bool ok = cv::solvePnP(obj, img_pts, Kcv, cv::Mat(),
+        toIdealPx(d.corners_px.data(), img.size(), img.data());
+        cv::Vec3d rvec, tvec;
+        bool ok = cv::solvePnP(obj_m, img_m, Kcv_, cv::noArray(),
                                rvec, tvec, false,
                                cv::SOLVEPNP_ITERATIVE);
         if (!ok) {
@@ -52,60 +75,565 @@ void MarkerTracker::addDetections(const std::vector<QrDetection>& dets,
             continue;
         }
 
-        cv::Mat Rcv;
+        cv::Matx33d Rcv;
         cv::Rodrigues(rvec, Rcv);
         Eigen::Matrix3d R_cm;
         Eigen::Vector3d t_cm;
         cv::cv2eigen(Rcv, R_cm);
-        cv::cv2eigen(tvec, t_cm);
+        cv::cv2eigen(cv::Matx31d(tvec), t_cm);
+
+        upsert(d.id, R_wc * R_cm, R_wc * t_cm + t_wc, marker_size, anchor);
+    }
+}
+
+void MarkerTracker::addDetectionsRgbd(const std::vector<QrDetection>& dets,
+                                      const cv::Mat& depth,
+                                      double depth_factor,
+                                      const Eigen::Matrix4d& T_cw,
+                                      double marker_size,
+                                      const KeyframeAnchor* anchor) {
+    if (dets.empty() || read_only_) return;
+    CV_Assert(depth.type() == CV_16UC1 || depth.type() == CV_32FC1);
+    syncAnchors();
+
+    const Eigen::Matrix4d T_wc = geom::invertSE3(T_cw);
+    const Eigen::Matrix3d R_wc = T_wc.block<3,3>(0,0);
+    const Eigen::Vector3d t_wc = T_wc.block<3,1>(0,3);
+
+    for (const auto& d : dets) {
+        Eigen::Matrix3d R_cm;
+        Eigen::Vector3d t_cm;
+        if (!poseFromDepthPlane(d, depth, depth_factor, R_cm, t_cm)) {
+            spdlog::warn("[MarkerTracker] depth plane fit failed for {}", d.id);
+            continue;
+        }
+        upsert(d.id, R_wc * R_cm, R_wc * t_cm + t_wc, marker_size, anchor);
+    }
+}
+
+void MarkerTracker::upsert(const std::string& id,
+                           const Eigen::Matrix3d& R_wm,
+                           const Eigen::Vector3d& t_wm,
+                           double marker_size,
+                           const KeyframeAnchor* anchor) {
+    // окно скользящего среднего: старые наблюдения постепенно забываются
+    constexpr int kFuseWindow = 30;
+
+    // существующий маркер обновляем на месте — без копии строки
+    auto it = map_.find(id);
+    if (it == map_.end()) {
+        it = map_.emplace(id, MarkerInfo{id, t_wm, R_wm, marker_size}).first;
+        it->second.last_seen = now_;
+        spdlog::info("[MarkerTracker] +{}", id);
+    } else {
+        // слияние: t — взвешенное среднее, R — slerp к новому наблюдению
+        MarkerInfo& mk = it->second;
+        const double w = 1.0 / (std::min(mk.num_obs, kFuseWindow - 1) + 1);
+        mk.t_w = (1.0 - w) * mk.t_w + w * t_wm;
+        const Eigen::Quaterniond q0(mk.R_w);
+        Eigen::Quaterniond q1(R_wm);
+        if (q0.dot(q1) < 0) q1.coeffs() = -q1.coeffs();       // короткая дуга
+        mk.R_w  = q0.slerp(w, q1).normalized().toRotationMatrix();
+        mk.size = marker_size;
+    }
+    ++it->second.num_obs;
+
+    if (anchor) attach(it->second, *anchor);
+    else        detach(it->second);
+}
+
+// ---------------------------------------------------------------------
+// поза по глубине: плоскость внутри четырёхугольника QR
+// ---------------------------------------------------------------------
+bool MarkerTracker::poseFromDepthPlane(const QrDetection& d,
+                                       const cv::Mat& depth,
+                                       double depth_factor,
+                                       Eigen::Matrix3d& R_cm,
+                                       Eigen::Vector3d& t_cm) const {
+    constexpr int kMaxSamples = 400;      // ~20×20 точек на маркер
+    constexpr int kMinSamples = 20;
+
+    const auto& q = d.corners_px;
+    cv::Rect box = cv::boundingRect(q) & cv::Rect(0, 0, depth.cols, depth.rows);
+    if (box.area() <= 0) return false;
+    const int step = std::max(1, static_cast<int>(std::sqrt(box.area() / double(kMaxSamples))));
+
+    // точка внутри выпуклого четырёхугольника: одинаковый знак всех рёбер
+    auto inside = [&q](float u, float v) {
+        int pos = 0, neg = 0;
+        for (int i = 0; i < 4; ++i) {
+            const cv::Point2f a = q[i], b = q[(i + 1) & 3];
+            const float c = (b.x - a.x) * (v - a.y) - (b.y - a.y) * (u - a.x);
+            (c >= 0 ? pos : neg)++;
+        }
+        return pos == 4 || neg == 4;
+    };
+    auto depthAt = [&](int u, int v) -> double {
+        const double raw = depth.type() == CV_16UC1
+            ? static_cast<double>(depth.at<std::uint16_t>(v, u))
+            : static_cast<double>(depth.at<float>(v, u));
+        return raw / depth_factor;
+    };
+
+    // выборка 3-D точек (на стеке) и МНК-плоскость: нормаль —
+    // собственный вектор ковариации с минимальным собственным числом.
+    // Пиксели сначала собираются, затем разом уходят в unproject.
+    std::array<cv::Point2f, kMaxSamples * 2> px;
+    std::array<double, kMaxSamples * 2>      zs;
+    int n = 0;
+    for (int v = box.y; v < box.y + box.height && n < int(px.size()); v += step)
+    for (int u = box.x; u < box.x + box.width  && n < int(px.size()); u += step) {
+        if (!inside(u + 0.5f, v + 0.5f)) continue;
+        const double z = depthAt(u, v);
+        if (!(z > 0.0) || !std::isfinite(z)) continue;
+        px[n] = {float(u), float(v)};
+        zs[n++] = z;
+    }
+    if (n < kMinSamples) return false;
+
+    geom::unprojectBatch(cam_, px.data(), std::size_t(n), px.data());   // → z = 1
+    std::array<Eigen::Vector3d, kMaxSamples * 2> pts;
+    for (int i = 0; i < n; ++i) pts[i] = {px[i].x * zs[i], px[i].y * zs[i], zs[i]};
+
+    Eigen::Vector3d normal, centroid;
+    auto fit = [&](const auto& use) {
+        Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+        int m = 0;
+        for (int i = 0; i < n; ++i) if (use(pts[i])) { mean += pts[i]; ++m; }
+        if (m < kMinSamples) return false;
+        mean /= m;
+        Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+        for (int i = 0; i < n; ++i)
+            if (use(pts[i])) { const Eigen::Vector3d e = pts[i] - mean; cov += e * e.transpose(); }
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es(cov);
+        normal   = es.eigenvectors().col(0);          // собственные числа по возрастанию
+        centroid = mean;
+        return true;
+    };
+
+    if (!fit([](const Eigen::Vector3d&) { return true; })) return false;
+
+    // второй проход без выбросов (края, фон в углах)
+    double rms = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const double e = normal.dot(pts[i] - centroid);
+        rms += e * e;
+    }
+    rms = std::sqrt(rms / n);
+    const double gate = std::max(3.0 * rms, 0.005);
+    const Eigen::Vector3d n0 = normal, c0 = centroid;
+    if (!fit([&](const Eigen::Vector3d& p) { return std::abs(n0.dot(p - c0)) <= gate; }))
+        return false;
+
+    // z маркера смотрит от камеры, как у решения PnP
+    if (normal.dot(centroid) < 0) normal = -normal;
+
+    // пересечение луча через угол с плоскостью
+    std::array<cv::Point2f, 4> qn;
+    geom::unprojectBatch(cam_, q.data(), qn.size(), qn.data());
+    auto onPlane = [&](const cv::Point2f& xy, Eigen::Vector3d& P) {
+        const Eigen::Vector3d ray(xy.x, xy.y, 1.0);
+        const double den = normal.dot(ray);
+        if (std::abs(den) < 1e-6) return false;
+        P = ray * (normal.dot(centroid) / den);
+        return P.z() > 0;
+    };
+
+    Eigen::Vector3d c3[4];
+    for (int i = 0; i < 4; ++i)
+        if (!onPlane(qn[i], c3[i])) return false;
+
+    // оси: x вдоль верхнего/нижнего ребра, z — нормаль, y = z × x
+    Eigen::Vector3d x = (c3[1] - c3[0]) + (c3[2] - c3[3]);
+    x -= normal * normal.dot(x);
+    if (x.norm() < 1e-9) return false;
+    x.normalize();
+    R_cm.col(0) = x;
+    R_cm.col(1) = normal.cross(x);
+    R_cm.col(2) = normal;
+    t_cm = 0.25 * (c3[0] + c3[1] + c3[2] + c3[3]);
+    return true;
+}
+
+void MarkerTracker::markSeen(const std::vector<QrDetection>& dets, double ts) {
+    now_ = ts;
+    for (const auto& d : dets) {
+        const auto it = map_.find(d.id);
+        if (it != map_.end()) it->second.last_seen = ts;
+    }
+}
+
+void MarkerTracker::markSeenInView(const Eigen::Matrix4d& T_cw,
+                                   int img_w, int img_h, double ts) {
+    syncAnchors();
+    now_ = ts;
+    const Eigen::Matrix3d R_cw = T_cw.block<3,3>(0,0);
+    const Eigen::Vector3d t_cw = T_cw.block<3,1>(0,3);
+    proj_pc_.clear();
+    proj_mk_.clear();
+    for (auto& [id, mk] : map_) {
+        const Eigen::Vector3d p_c = R_cw * mk.t_w + t_cw;
+        if (p_c.z() <= 0.05) continue;
+        proj_pc_.push_back(p_c);
+        proj_mk_.push_back(&mk);
+    }
+    proj_px_.resize(proj_pc_.size());
+    geom::projectBatch(cam_, proj_pc_.data(), proj_pc_.size(), proj_px_.data());
+
+    for (std::size_t i = 0; i < proj_px_.size(); ++i) {
+        const cv::Point2f& px = proj_px_[i];
+        if (px.x >= 0 && px.x < img_w && px.y >= 0 && px.y < img_h)
+            proj_mk_[i]->last_seen = ts;
+    }
+}
+
+std::size_t MarkerTracker::evictUnseen(double older_than) {
+    if (read_only_) return 0;
+    std::size_t n = 0;
+    for (auto it = map_.begin(); it != map_.end();) {
+        if (it->second.last_seen < older_than) {
+            detach(it->second);                   // убрать указатель из якоря
+            spdlog::info("[MarkerTracker] -{} (not seen for {:.0f} s)",
+                         it->first, now_ - it->second.last_seen);
+            it = map_.erase(it);
+            ++n;
+        } else {
+            ++it;
+        }
+    }
+    return n;
+}
 
-        Eigen::Matrix3d R_wm = R_wc * R_cm;
-        Eigen::Vector3d t_wm = R_wc * t_cm + t_wc;
+std::vector<std::uint64_t> MarkerTracker::anchorIds() const {
+    std::vector<std::uint64_t> ids;
+    ids.reserve(anchors_.size());
+    for (const auto& [id, anc] : anchors_) ids.push_back(id);
+    return ids;
+}
+
+std::size_t MarkerTracker::memoryBytes() const {
+    // узел unordered_map ≈ значение + ключ + next/hash; плюс кучи строк
+    constexpr std::size_t kNode = 2 * sizeof(void*);
+    std::size_t b = map_.bucket_count() * sizeof(void*) +
+                    anchors_.bucket_count() * sizeof(void*);
+    for (const auto& [id, mk] : map_)
+        b += sizeof(std::string) + sizeof(MarkerInfo) + kNode + id.capacity() + mk.id.capacity();
+    for (const auto& [kf, anc] : anchors_)
+        b += sizeof(std::uint64_t) + sizeof(Anchor) + kNode + anc.markers.capacity() * sizeof(void*);
+    return b;
+}
+
+void MarkerTracker::markMapChanged(KeyframePoseFn pose_of) {
+    if (anchors_.empty()) return;
+    pose_of_       = std::move(pose_of);
+    anchors_dirty_ = true;
+}
 
-        map_[d.id] = MarkerInfo{d.id, t_wm, R_wm, marker_size};
-        spdlog::info("[MarkerTracker] +{}", d.id);
+void MarkerTracker::clear() {
+    map_.clear();
+    anchors_.clear();
+    anchors_dirty_ = false;
+}
+
+// ---------------------------------------------------------------------
+// база маркеров
+// ---------------------------------------------------------------------
+bool MarkerTracker::save(const std::string& path) const {
+    syncAnchors();
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        spdlog::error("[MarkerTracker] cannot write {}", path);
+        return false;
     }
+
+    fs << "markers" << "[";
+    for (const auto& [id, mk] : map_) {
+        cv::Matx33d R;
+        cv::Matx31d t;
+        cv::eigen2cv(mk.R_w, R);
+        cv::eigen2cv(mk.t_w, t);
+        fs << "{" << "id" << id << "size" << mk.size << "num_obs" << mk.num_obs
+           << "R_w" << cv::Mat(R) << "t_w" << cv::Mat(t);
+        // FileStorage хранит только int: id кейфреймов на практике меньше
+        if (mk.anchor_kf <= static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+            cv::Matx44d T_km;
+            cv::eigen2cv(mk.T_km, T_km);
+            fs << "anchor_kf" << static_cast<int>(mk.anchor_kf) << "T_km" << cv::Mat(T_km);
+        }
+        fs << "}";
+    }
+    fs << "]";
+    spdlog::info("[MarkerTracker] saved {} markers to {}", map_.size(), path);
+    return true;
 }
 
-void MarkerTracker::clear() { map_.clear(); }
+bool MarkerTracker::load(const std::string& path) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        spdlog::error("[MarkerTracker] cannot read {}", path);
+        return false;
+    }
+
+    clear();
+    for (const cv::FileNode& n : fs["markers"]) {
+        MarkerInfo mk;
+        cv::Mat R, t;
+        n["id"]   >> mk.id;
+        n["size"] >> mk.size;
+        mk.num_obs = n["num_obs"].empty() ? 1 : static_cast<int>(n["num_obs"]);
+        n["R_w"]  >> R;
+        n["t_w"]  >> t;
+        if (mk.id.empty() || R.size() != cv::Size(3, 3) || t.total() != 3) {
+            spdlog::warn("[MarkerTracker] {}: skipping malformed marker", path);
+            continue;
+        }
+        cv::cv2eigen(R, mk.R_w);
+        cv::cv2eigen(t.reshape(1, 3), mk.t_w);
+        MarkerInfo& ref = map_.emplace(mk.id, std::move(mk)).first->second;
+
+        if (!n["anchor_kf"].empty()) {
+            cv::Mat Tm;
+            n["T_km"] >> Tm;
+            if (Tm.size() != cv::Size(4, 4)) continue;
+            Eigen::Matrix4d T_km, T_wm = Eigen::Matrix4d::Identity();
+            cv::cv2eigen(Tm, T_km);
+            T_wm.block<3,3>(0,0) = ref.R_w;
+            T_wm.block<3,1>(0,3) = ref.t_w;
+            // поза кейфрейма на момент сохранения: T_kw = T_km · T_wm⁻¹
+            attach(ref, KeyframeAnchor{static_cast<std::uint64_t>(static_cast<int>(n["anchor_kf"])),
+                                       T_km * geom::invertSE3(T_wm)});
+        }
+    }
+    spdlog::info("[MarkerTracker] loaded {} markers ({} anchors) from {}",
+                 map_.size(), anchors_.size(), path);
+    return true;
+}
 
 std::optional<MarkerInfo>
 MarkerTracker::get(const std::string& id) const {
+    syncAnchors();
     auto it = map_.find(id);
     if (it == map_.end()) return std::nullopt;
     return it->second;
 }
 
-std::vector<ProjectedMarker>
+std::optional<double>
+MarkerTracker::reprojectionError(const QrDetection& d, const Eigen::Matrix4d& T_cw) const {
+    syncAnchors();
+    auto it = map_.find(d.id);
+    if (it == map_.end()) return std::nullopt;
+    const MarkerInfo& mk = it->second;
+
+    // углы в СК маркера — в том же порядке, что объектные точки PnP
+    const double h = mk.size / 2;
+    const std::array<Eigen::Vector3d,4> obj{{
+        {-h,-h,0}, { h,-h,0}, { h, h,0}, {-h, h,0}
+    }};
+    const Eigen::Matrix3d R_cm = T_cw.block<3,3>(0,0) * mk.R_w;
+    const Eigen::Vector3d t_cm = T_cw.block<3,3>(0,0) * mk.t_w + T_cw.block<3,1>(0,3);
+
+    std::array<Eigen::Vector3d,4> p_c;
+    for (std::size_t i = 0; i < obj.size(); ++i) {
+        p_c[i] = R_cm * obj[i] + t_cm;
+        if (p_c[i].z() <= 1e-6) return std::nullopt;
+    }
+    std::array<cv::Point2f,4> px;
+    geom::projectBatch(cam_, p_c.data(), px.size(), px.data());
+
+    double sq = 0.0;
+    for (std::size_t i = 0; i < obj.size(); ++i) {
+        if (!std::isfinite(px[i].x)) return std::nullopt;   // за полем зрения модели
+        const double du = px[i].x - d.corners_px[i].x;
+        const double dv = px[i].y - d.corners_px[i].y;
+        sq += du * du + dv * dv;
+    }
+    return std::sqrt(sq / obj.size());
+}
+
+std::size_t MarkerTracker::numFusedInView(const Eigen::Matrix4d& T_cw,
+                                          int img_w, int img_h, int min_obs) const {
+    syncAnchors();
+    const Eigen::Matrix3d R_cw = T_cw.block<3,3>(0,0);
+    const Eigen::Vector3d t_cw = T_cw.block<3,1>(0,3);
+    proj_pc_.clear();
+    for (const auto& [id, mk] : map_) {
+        if (mk.num_obs < min_obs) continue;
+        const Eigen::Vector3d p_c = R_cw * mk.t_w + t_cw;
+        if (p_c.z() > 0.05) proj_pc_.push_back(p_c);
+    }
+    proj_px_.resize(proj_pc_.size());
+    geom::projectBatch(cam_, proj_pc_.data(), proj_pc_.size(), proj_px_.data());
+
+    std::size_t n = 0;
+    for (const cv::Point2f& px : proj_px_)
+        if (px.x >= 0 && px.x < img_w && px.y >= 0 && px.y < img_h) ++n;
+    return n;
+}
+
+std::optional<Eigen::Matrix4d>
+MarkerTracker::poseFromMarkers(const std::vector<QrDetection>& dets,
+                               const Eigen::Matrix4d& T_cw_guess,
+                               const JointPnpParams& p) const {
+    syncAnchors();
+    pnp_obj_.clear();
+    pnp_img_.clear();
+
+    // мировые углы слитых маркеров — в порядке углов детекции (TL, TR, BR, BL)
+    int used = 0;
+    for (const auto& d : dets) {
+        const auto it = map_.find(d.id);
+        if (it == map_.end() || it->second.num_obs < p.min_obs) continue;
+        const MarkerInfo& mk = it->second;
+        const double h = mk.size / 2;
+        const std::array<Eigen::Vector3d,4> obj{{
+            {-h,-h,0}, { h,-h,0}, { h, h,0}, {-h, h,0}
+        }};
+        for (int i = 0; i < 4; ++i) {
+            const Eigen::Vector3d P = mk.R_w * obj[i] + mk.t_w;
+            pnp_obj_.emplace_back(float(P.x()), float(P.y()), float(P.z()));
+            pnp_img_.push_back(d.corners_px[i]);
+        }
+        ++used;
+    }
+    if (used < std::max(1, p.min_markers)) return std::nullopt;
+    toIdealPx(pnp_img_.data(), pnp_img_.size(), pnp_img_.data());
+
+    // начальное приближение — прошлая поза: итеративный PnP сходится за
+    // пару итераций и не прыгает между решениями плоской сцены
+    cv::Matx33d Rg;
+    cv::eigen2cv(Eigen::Matrix3d(T_cw_guess.block<3,3>(0,0)), Rg);
+    cv::Vec3d rvec, tvec(T_cw_guess(0,3), T_cw_guess(1,3), T_cw_guess(2,3));
+    cv::Rodrigues(Rg, rvec);
+    if (!cv::solvePnP(pnp_obj_, pnp_img_, Kcv_, cv::noArray(), rvec, tvec,
+                      true, cv::SOLVEPNP_ITERATIVE))
+        return std::nullopt;
+
+    cv::Matx33d Rcv;
+    cv::Rodrigues(rvec, Rcv);
+    Eigen::Matrix4d T_cw = Eigen::Matrix4d::Identity();
+    Eigen::Matrix3d R;
+    cv::cv2eigen(Rcv, R);
+    T_cw.block<3,3>(0,0) = R;
+    T_cw.block<3,1>(0,3) = Eigen::Vector3d(tvec[0], tvec[1], tvec[2]);
+
+    // контроль качества: RMS в пикселях идеального пинхола
+    double sq = 0.0;
+    for (std::size_t i = 0; i < pnp_obj_.size(); ++i) {
+        const Eigen::Vector3d p_c =
+            R * Eigen::Vector3d(pnp_obj_[i].x, pnp_obj_[i].y, pnp_obj_[i].z) + T_cw.block<3,1>(0,3);
+        if (p_c.z() <= 1e-6) return std::nullopt;
+        const double du = K_.fx * p_c.x() / p_c.z() + K_.cx - pnp_img_[i].x;
+        const double dv = K_.fy * p_c.y() / p_c.z() + K_.cy - pnp_img_[i].y;
+        sq += du * du + dv * dv;
+    }
+    if (std::sqrt(sq / pnp_obj_.size()) > p.max_rms_px) return std::nullopt;
+    return T_cw;
+}
+
+std::pmr::vector<ProjectedMarker>
 MarkerTracker::projectMarkers(const Eigen::Matrix4d& T_cw,
-                              int img_w, int img_h) const {
-    std::vector<ProjectedMarker> out;
+                              int img_w, int img_h,
+                              std::pmr::memory_resource* mr) const {
+    syncAnchors();
+    std::pmr::vector<ProjectedMarker> out{mr};
+    out.reserve(map_.size());
     Eigen::Matrix3d R_cw = T_cw.block<3,3>(0,0);
     Eigen::Vector3d t_cw = T_cw.block<3,1>(0,3);
 
+    // центры перед камерой — в буфер, затем одним пакетом в пиксели
+    proj_pc_.clear();
     for (const auto& [id, mk] : map_) {
         Eigen::Vector3d p_c = R_cw * mk.t_w + t_cw;
         if (p_c.z() <= 0.05) continue;
+        proj_pc_.push_back(p_c);
+        out.push_back({id, {}, false, p_c.norm()});
+    }
+    proj_px_.resize(proj_pc_.size());
+    geom::projectBatch(cam_, proj_pc_.data(), proj_pc_.size(), proj_px_.data());
 
-        double u = (K_.fx * p_c.x()) / p_c.z() + K_.cx;
-        double v = (K_.fy * p_c.y()) / p_c.z() + K_.cy;
-        bool inside = (u >= 0 && u < img_w && v >= 0 && v < img_h);
-
-        out.push_back({id, cv::Point2f(float(u),float(v)),
-                       inside, p_c.norm()});
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        const cv::Point2f& px = proj_px_[i];
+        out[i].center_px = px;
+        out[i].in_view   = px.x >= 0 && px.x < img_w && px.y >= 0 && px.y < img_h;
     }
     return out;
 }
 
+// ---------------------------------------------------------------------
+// привязка к кейфреймам
+// ---------------------------------------------------------------------
+void MarkerTracker::attach(MarkerInfo& mk, const KeyframeAnchor& a) {
+    if (mk.anchor_kf != a.id) {
+        detach(mk);
+        auto& anc = anchors_.try_emplace(a.id, Anchor{a.T_cw, {}}).first->second;
+        anc.markers.push_back(&mk);
+        mk.anchor_kf = a.id;
+    }
+
+    // T_km = T_kw · T_wm
+    Eigen::Matrix4d T_wm = Eigen::Matrix4d::Identity();
+    T_wm.block<3,3>(0,0) = mk.R_w;
+    T_wm.block<3,1>(0,3) = mk.t_w;
+    mk.T_km = a.T_cw * T_wm;
+}
+
+void MarkerTracker::detach(MarkerInfo& mk) {
+    if (mk.anchor_kf == kNoAnchor) return;
+    auto it = anchors_.find(mk.anchor_kf);
+    if (it != anchors_.end()) {
+        auto& v = it->second.markers;
+        v.erase(std::remove(v.begin(), v.end(), &mk), v.end());
+        if (v.empty()) anchors_.erase(it);
+    }
+    mk.anchor_kf = kNoAnchor;
+}
+
+void MarkerTracker::syncAnchors() const {
+    if (!anchors_dirty_) return;
+    anchors_dirty_ = false;
+
+    std::size_t moved = 0, lost = 0;
+    for (auto it = anchors_.begin(); it != anchors_.end();) {
+        Anchor& anc = it->second;
+        const auto T_kw = pose_of_(it->first);
+
+        if (!T_kw) {
+            // кейфрейм удалён: оставляем последнюю мировую позу,
+            // новая привязка появится при следующем наблюдении
+            for (MarkerInfo* mk : anc.markers) mk->anchor_kf = kNoAnchor;
+            lost += anc.markers.size();
+            it = anchors_.erase(it);
+            continue;
+        }
+
+        if (!T_kw->isApprox(anc.T_cw, 1e-9)) {
+            anc.T_cw = *T_kw;
+            const Eigen::Matrix4d T_wk = geom::invertSE3(*T_kw);
+            for (MarkerInfo* mk : anc.markers) {
+                const Eigen::Matrix4d T_wm = T_wk * mk->T_km;
+                mk->R_w = T_wm.block<3,3>(0,0);
+                mk->t_w = T_wm.block<3,1>(0,3);
+            }
+            moved += anc.markers.size();
+        }
+        ++it;
+    }
+
+    if (moved || lost)
+        spdlog::debug("[MarkerTracker] anchors: {} markers moved, {} detached", moved, lost);
+}
+
 void MarkerTracker::drawOverlay(cv::Mat& frame_bgr,
-                                const Eigen::Matrix4d& T_cw) const {
-    auto vis = projectMarkers(T_cw, frame_bgr.cols, frame_bgr.rows);
+                                const Eigen::Matrix4d& T_cw,
+                                std::pmr::memory_resource* mr) const {
+    auto vis = projectMarkers(T_cw, frame_bgr.cols, frame_bgr.rows, mr);
     for (const auto& pm : vis) {
+        if (!std::isfinite(pm.center_px.x)) continue;       // за полем зрения модели
         cv::Scalar col = pm.in_view ? cv::Scalar(0,255,0)
                                     : cv::Scalar(120,120,120);
         cv::circle(frame_bgr, pm.center_px, 6, col, 2, cv::LINE_AA);
         if (pm.in_view) {
-            cv::putText(frame_bgr, pm.id,
+            cv::putText(frame_bgr, cv::String(pm.id),
                         pm.center_px + cv::Point2f(8,-8),
                         cv::FONT_HERSHEY_SIMPLEX, .55,
                         cv::Scalar(255,0,0), 2, cv::LINE_AA);
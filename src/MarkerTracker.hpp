@@ -6,14 +6,21 @@
  * © 2025 YourCompany — MIT License.
  */
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory_resource>
 #include <unordered_map>
 #include <optional>
 #include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
 
 #include <Eigen/Core>
 #include <opencv2/core.hpp>
 
+#include "utils/CameraModel.hpp"
+
 namespace qrslam {
 
     // ---------- входные/выходные структуры ---------------------------------
@@ -22,49 +29,192 @@ namespace qrslam {
         std::array<cv::Point2f,4> corners_px;        ///< углы (пиксели)
     };
 
+    constexpr std::uint64_t kNoAnchor = std::numeric_limits<std::uint64_t>::max();
+
     struct MarkerInfo {
         std::string     id;
-        Eigen::Vector3d t_w;       ///< центр маркера в мировой СК
+        Eigen::Vector3d t_w;       ///< центр маркера в мировой СК (кэш, см. anchor_kf)
         Eigen::Matrix3d R_w;       ///< ориентация
         double          size;      ///< сторона квадрата, м
+        std::uint64_t   anchor_kf = kNoAnchor;                   ///< опорный кейфрейм
+        Eigen::Matrix4d T_km      = Eigen::Matrix4d::Identity(); ///< маркер → СК кейфрейма
+        int             num_obs   = 0;     ///< слито наблюдений (скользящее среднее)
+        double          last_seen = 0.0;   ///< последняя детекция (или кадр гейта), с
     };
 
+    /// id ссылается на ключ карты MarkerTracker: валиден, пока карта
+    /// не меняется (в пределах кадра).
     struct ProjectedMarker {
-        std::string id;
+        std::string_view id;
         cv::Point2f center_px;
         bool        in_view;
         double      depth_m;
     };
 
     // ---------- класс-обёртка ----------------------------------------------
+    /**
+     *  Маркеры привязаны к кейфрейму, из которого их наблюдали (T_km).
+     *  Мировая поза — ленивый кэш: после markMapChanged() при следующем
+     *  чтении пересчитываются только маркеры тех кейфреймов, чья поза
+     *  действительно изменилась (loop closure, global BA).
+     */
     class MarkerTracker {
     public:
         struct CameraIntrinsics { double fx, fy, cx, cy; };
 
+        /// Опорный кейфрейм наблюдения: id и его T_cw на момент скана.
+        struct KeyframeAnchor { std::uint64_t id; Eigen::Matrix4d T_cw; };
+
+        /// Условия одометрии только по маркерам (совместный PnP).
+        struct JointPnpParams {
+            int    min_markers = 2;     ///< известных маркеров в кадре
+            int    min_obs     = 3;     ///< наблюдений, чтобы маркер считался слитым
+            double max_rms_px  = 2.0;   ///< порог RMS репроекции решения
+        };
+
+        /// Текущая T_cw кейфрейма; nullopt — кейфрейм удалён из карты.
+        using KeyframePoseFn =
+            std::function<std::optional<Eigen::Matrix4d>(std::uint64_t kf_id)>;
+
         explicit MarkerTracker(const CameraIntrinsics& K);
 
-        /** Добавить/обновить по новым детекциям. */
+        /** Модель объектива (geom::cameraModelFromConfig по camera.yaml).
+         *  По умолчанию — пинхол по K. Углы QR перед PnP / лучами и
+         *  проекции маркеров идут пакетами через её ядра. */
+        void setCameraModel(geom::CameraModel cam);
+
+        /** Добавить/обновить по новым детекциям.
+         *  @param anchor  кейфрейм для привязки; nullptr — без привязки. */
         void addDetections(const std::vector<QrDetection>& dets,
                            const Eigen::Matrix4d& T_cw,
-                           double marker_size_m);
+                           double marker_size_m,
+                           const KeyframeAnchor* anchor = nullptr);
+
+        /** RGB-D: поза по плоскости, вписанной в пиксели глубины внутри
+         *  четырёхугольника QR (без итеративного PnP, метрический масштаб).
+         *  @param depth         CV_16UC1 или CV_32FC1, выровнена с цветом
+         *  @param depth_factor  raw / depth_factor = метры (TUM: 5000) */
+        void addDetectionsRgbd(const std::vector<QrDetection>& dets,
+                               const cv::Mat& depth,
+                               double depth_factor,
+                               const Eigen::Matrix4d& T_cw,
+                               double marker_size_m,
+                               const KeyframeAnchor* anchor = nullptr);
+
+        /** Карта SLAM оптимизирована: пометить привязки устаревшими.
+         *  Сам пересчёт — лениво, при следующем чтении поз. */
+        void markMapChanged(KeyframePoseFn pose_of);
+
+        /// число кейфреймов, к которым привязаны маркеры
+        std::size_t numAnchors() const { return anchors_.size(); }
 
         void clear();
         std::size_t size() const { return map_.size(); }
 
+        /** Только чтение (режим локализации по готовой карте): add* ничего
+         *  не меняют, карта маркеров — как загружена. */
+        void setReadOnly(bool ro) { read_only_ = ro; }
+        bool readOnly() const { return read_only_; }
+
+        /** База маркеров (cv::FileStorage, YAML/JSON по расширению):
+         *  мировые позы + привязки к кейфреймам сохранённой карты SLAM.
+         *  load() заменяет текущее содержимое. false — ошибка файла. */
+        bool save(const std::string& path) const;
+        bool load(const std::string& path);
+
         std::optional<MarkerInfo> get(const std::string& id) const;
+        bool contains(const std::string& id) const { return map_.count(id) != 0; }
+
+        /** Маркеры из dets видны в момент ts (для вытеснения по давности);
+         *  новые маркеры, добавленные следом, получают тот же ts. */
+        void markSeen(const std::vector<QrDetection>& dets, double ts);
 
-        /** Вернуть спроектированные центры всех маркеров. */
-        std::vector<ProjectedMarker>
+        /** Кадр не сканировался (гейт движения), но сцена та же: маркеры,
+         *  центр которых при позе T_cw попадает в кадр, видны в момент ts. */
+        void markSeenInView(const Eigen::Matrix4d& T_cw, int img_w, int img_h, double ts);
+
+        /** Забыть маркеры, не виденные с момента @p older_than (с).
+         *  В режиме только чтения — ничего. @return сколько удалено. */
+        std::size_t evictUnseen(double older_than);
+
+        /// id кейфреймов, к которым привязаны маркеры (их нельзя прореживать)
+        std::vector<std::uint64_t> anchorIds() const;
+
+        /// оценка занимаемой памяти, байт (узлы карт + строки id)
+        std::size_t memoryBytes() const;
+
+        /** Сколько слитых маркеров (num_obs ≥ min_obs) попадает в кадр
+         *  при позе T_cw — дешёвый прогноз перед joint PnP. */
+        std::size_t numFusedInView(const Eigen::Matrix4d& T_cw, int img_w, int img_h,
+                                   int min_obs) const;
+
+        /** Поза камеры только по маркерам: один PnP по углам всех слитых
+         *  маркеров из dets (их мировые углы известны). nullopt — маркеров
+         *  меньше min_markers или RMS выше порога.
+         *  @param T_cw_guess  начальное приближение (поза прошлого кадра) */
+        std::optional<Eigen::Matrix4d>
+        poseFromMarkers(const std::vector<QrDetection>& dets,
+                        const Eigen::Matrix4d& T_cw_guess,
+                        const JointPnpParams& p) const;
+
+        /** RMS-ошибка (пиксели) углов известного маркера, спроецированных
+         *  по T_cw, относительно детекции d; nullopt — маркер ещё не в карте
+         *  или за камерой. Вызывать до addDetections с тем же d. */
+        std::optional<double> reprojectionError(const QrDetection& d,
+                                                const Eigen::Matrix4d& T_cw) const;
+
+        /** Вернуть спроектированные центры всех маркеров.
+         *  Память берётся из @p mr (обычно — кадровая арена). */
+        std::pmr::vector<ProjectedMarker>
         projectMarkers(const Eigen::Matrix4d& T_cw,
-                       int img_w, int img_h) const;
+                       int img_w, int img_h,
+                       std::pmr::memory_resource* mr =
+                           std::pmr::get_default_resource()) const;
 
         /** Нарисовать кружок + подпись ID на кадре. */
         void drawOverlay(cv::Mat& frame_bgr,
-                         const Eigen::Matrix4d& T_cw) const;
+                         const Eigen::Matrix4d& T_cw,
+                         std::pmr::memory_resource* mr =
+                             std::pmr::get_default_resource()) const;
 
     private:
+        struct Anchor {
+            Eigen::Matrix4d          T_cw;      ///< поза кейфрейма при последнем пересчёте
+            std::vector<MarkerInfo*> markers;   ///< узлы map_ (адреса стабильны)
+        };
+
+        void upsert(const std::string& id,
+                    const Eigen::Matrix3d& R_wm, const Eigen::Vector3d& t_wm,
+                    double marker_size, const KeyframeAnchor* anchor);
+        bool poseFromDepthPlane(const QrDetection& d, const cv::Mat& depth,
+                                double depth_factor,
+                                Eigen::Matrix3d& R_cm, Eigen::Vector3d& t_cm) const;
+        void attach(MarkerInfo& mk, const KeyframeAnchor& a);
+        void detach(MarkerInfo& mk);
+        void syncAnchors() const;               // ленивый пересчёт t_w/R_w
+        /// пиксели кадра → пиксели идеального пинхола K_ (можно на месте)
+        void toIdealPx(const cv::Point2f* px, std::size_t n, cv::Point2f* out) const;
+
         CameraIntrinsics                              K_;
-        std::unordered_map<std::string, MarkerInfo>   map_;
+        cv::Matx33d                                   Kcv_;   ///< K в виде OpenCV (без heap)
+        geom::CameraModel                             cam_;   ///< пиксели кадра ↔ лучи
+
+        // мировые позы — кэш, обновляемый из const-методов чтения
+        mutable std::unordered_map<std::string, MarkerInfo>   map_;
+        mutable std::unordered_map<std::uint64_t, Anchor>     anchors_;
+        mutable KeyframePoseFn                                pose_of_;
+        mutable bool                                          anchors_dirty_ = false;
+        bool                                                  read_only_     = false;
+        double                                                now_           = 0.0;  // последний markSeen
+
+        // буферы joint PnP (ёмкость сохраняется между кадрами)
+        mutable std::vector<cv::Point3f>                      pnp_obj_;
+        mutable std::vector<cv::Point2f>                      pnp_img_;
+
+        // буферы пакетной проекции центров маркеров
+        mutable std::vector<Eigen::Vector3d>                  proj_pc_;
+        mutable std::vector<cv::Point2f>                      proj_px_;
+        std::vector<MarkerInfo*>                              proj_mk_;   // markSeenInView
     };
 
 } // namespace qrslam
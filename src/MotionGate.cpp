@@ -0,0 +1,94 @@
+/**
+ * @file   MotionGate.cpp
+ */
+#include "MotionGate.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace qrslam {
+
+namespace {
+
+/// Σ|a − b| по n байтам
+inline std::uint32_t sad(const std::uint8_t* a, const std::uint8_t* b, int n) {
+    int x = 0;
+    std::uint32_t s = 0;
+#if CV_SIMD
+    for (; x <= n - CV_SIMD_WIDTH; x += CV_SIMD_WIDTH)
+        s += cv::v_reduce_sad(cv::vx_load(a + x), cv::vx_load(b + x));
+#endif
+    for (; x < n; ++x) s += static_cast<std::uint32_t>(std::abs(int(a[x]) - int(b[x])));
+    return s;
+}
+
+} // namespace
+
+MotionGate::MotionGate(const Params& p) : p_{p} {
+    p_.tiles_x     = std::max(1, p_.tiles_x);
+    p_.tiles_y     = std::max(1, p_.tiles_y);
+    p_.thumb_width = std::max(p_.tiles_x, p_.thumb_width);
+    sums_.resize(static_cast<std::size_t>(p_.tiles_x * p_.tiles_y));
+}
+
+bool MotionGate::isStatic(const cv::Mat& frame) {
+    CV_Assert(frame.type() == CV_8UC3 || frame.type() == CV_8UC1);
+
+    // миниатюра прямо из BGR: полный кадр в серый не конвертируется
+    const int tw = p_.thumb_width;
+    const int th = std::max(p_.tiles_y, cvRound(tw * static_cast<double>(frame.rows) / frame.cols));
+    cv::resize(frame, small_, cv::Size(tw, th), 0, 0, cv::INTER_AREA);
+    if (small_.channels() == 3) cv::cvtColor(small_, cur_, cv::COLOR_BGR2GRAY);
+    else                        cv::swap(small_, cur_);
+
+    if (ref_.size() != cur_.size()) {              // первый кадр / reset() / смена размера
+        counts_.assign(sums_.size(), 0);
+        for (int y = 0; y < th; ++y) {
+            const int ty = y * p_.tiles_y / th;
+            for (int tx = 0; tx < p_.tiles_x; ++tx)
+                counts_[ty * p_.tiles_x + tx] += static_cast<std::uint32_t>(
+                    (tx + 1) * tw / p_.tiles_x - tx * tw / p_.tiles_x);
+        }
+        cv::swap(ref_, cur_);
+        since_ = 0;
+        return false;
+    }
+
+    score_ = maxTileMad();
+    const bool keepalive = p_.keepalive_frames > 0 &&
+                           since_ >= static_cast<std::uint64_t>(p_.keepalive_frames);
+    if (score_ > p_.threshold || keepalive) {
+        cv::swap(ref_, cur_);                      // опора = последний обработанный
+        since_ = 0;
+        return false;
+    }
+    ++since_;
+    ++skipped_;
+    return true;
+}
+
+double MotionGate::maxTileMad() const {
+    std::fill(sums_.begin(), sums_.end(), 0);
+    const int tw = cur_.cols, th = cur_.rows;
+    for (int y = 0; y < th; ++y) {
+        const std::uint8_t* a = ref_.ptr<std::uint8_t>(y);
+        const std::uint8_t* b = cur_.ptr<std::uint8_t>(y);
+        std::uint64_t* row = sums_.data() + (y * p_.tiles_y / th) * p_.tiles_x;
+        for (int tx = 0; tx < p_.tiles_x; ++tx) {
+            const int x0 = tx * tw / p_.tiles_x;
+            const int x1 = (tx + 1) * tw / p_.tiles_x;
+            row[tx] += sad(a + x0, b + x0, x1 - x0);
+        }
+    }
+
+    double worst = 0.0;
+    for (std::size_t i = 0; i < sums_.size(); ++i)
+        if (counts_[i] > 0)
+            worst = std::max(worst, static_cast<double>(sums_[i]) / counts_[i]);
+    return worst;
+}
+
+} // namespace qrslam
@@ -0,0 +1,62 @@
+#pragma once
+/**
+ * @file   MotionGate.hpp
+ * @brief  Дешёвый детектор движения: пропуск SLAM и QR на статичных кадрах.
+ *
+ *  Кадр сжимается до миниатюры (INTER_AREA прямо из BGR, ~128 px по
+ *  ширине) и сравнивается с миниатюрой последнего ОБРАБОТАННОГО кадра:
+ *  SIMD-сумма абсолютных разностей по сетке тайлов. Движение — если
+ *  средний |Δ| яркости хотя бы в одном тайле выше порога; по тайлам,
+ *  а не по всему кадру, чтобы небольшой движущийся объект не растворялся
+ *  в неподвижном фоне. Медленный дрейф (освещение) накапливается против
+ *  опорной миниатюры и тоже рано или поздно даёт «движение».
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace qrslam {
+
+class MotionGate {
+public:
+    struct Params {
+        int    thumb_width      = 128;   ///< ширина миниатюры, px (высота — по аспекту)
+        int    tiles_x          = 4;     ///< сетка тайлов
+        int    tiles_y          = 3;
+        double threshold        = 4.0;   ///< средний |Δ| (0..255) в худшем тайле
+        int    keepalive_frames = 0;     ///< полная обработка хотя бы раз в N кадров (0 = нет)
+    };
+
+    MotionGate() : MotionGate(Params{}) {}
+    explicit MotionGate(const Params& p);
+
+    /**
+     * @brief  true — сцена не изменилась с последнего обработанного кадра,
+     *         кадр можно пропустить. false — движение (или первый кадр):
+     *         кадр обрабатывается и становится новой опорой.
+     * @param  frame  BGR 8UC3 или серый 8UC1
+     */
+    bool isStatic(const cv::Mat& frame);
+
+    /// Следующий кадр обработать безусловно (сброс SLAM, ручной скан…).
+    void reset() { ref_.release(); }
+
+    double        lastScore() const { return score_; }   ///< худший тайл, |Δ|
+    std::uint64_t skipped()   const { return skipped_; }   ///< всего пропущено кадров
+
+private:
+    double maxTileMad() const;
+
+    Params                             p_;
+    cv::Mat                            small_, cur_, ref_;   // миниатюры (буферы переиспользуются)
+    mutable std::vector<std::uint64_t> sums_;                // SAD по тайлам
+    std::vector<std::uint32_t>         counts_;              // пикселей в тайле
+    double                             score_   = 0.0;
+    std::uint64_t                      since_   = 0;         // статичных кадров подряд
+    std::uint64_t                      skipped_ = 0;
+};
+
+} // namespace qrslam
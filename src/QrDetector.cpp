@@ -0,0 +1,88 @@
+/**
+ * @file   QrDetector.cpp
+ * @brief  Бэкенды QrDetector на базе OpenCV + фабрика.
+ */
+#include "QrDetector.hpp"
+#include "QrFinderScanner.hpp"
+
+#include <stdexcept>
+
+#include <opencv2/objdetect.hpp>
+
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 8)
+#   define QRSLAM_HAVE_QR_ARUCO 1
+#endif
+
+namespace qrslam {
+
+namespace {
+
+//--------------------------------------------------------------
+// Общая обёртка над GraphicalCodeDetector-семейством OpenCV
+//--------------------------------------------------------------
+template <class Det>
+class OpenCvQrDetector final : public QrDetector {
+public:
+    explicit OpenCvQrDetector(const char* name) : name_{name} {}
+
+    void detect(const cv::Mat& gray, std::vector<QrDetection>& out) override {
+        out.clear();
+        data_.clear();
+        corners_.clear();
+
+        if (!det_.detectAndDecodeMulti(gray, data_, corners_)) return;
+
+        // углы приходят плоским массивом N×4
+        for (std::size_t i = 0; i < data_.size(); ++i) {
+            if (data_[i].empty()) continue;
+            QrDetection d;
+            d.id = std::move(data_[i]);
+            std::copy_n(&corners_[i * 4], 4, d.corners_px.begin());
+            out.push_back(std::move(d));
+        }
+    }
+
+    const char* name() const override { return name_; }
+
+private:
+    const char*               name_;
+    Det                       det_;
+    std::vector<std::string>  data_;      // переиспользуемые буферы
+    std::vector<cv::Point2f>  corners_;
+};
+
+} // namespace
+
+//--------------------------------------------------------------
+// фабрика
+//--------------------------------------------------------------
+std::unique_ptr<QrDetector> makeQrDetector(const std::string& kind) {
+    if (kind == "opencv")
+        return std::make_unique<OpenCvQrDetector<cv::QRCodeDetector>>("opencv");
+#ifdef QRSLAM_HAVE_QR_ARUCO
+    if (kind == "aruco")
+        return std::make_unique<OpenCvQrDetector<cv::QRCodeDetectorAruco>>("aruco");
+#endif
+    if (kind == "finder")
+        return std::make_unique<QrFinderScanner>();
+    if (kind == "zbar")        // значился в app.yaml, но ZBar никогда не линковался
+        throw std::invalid_argument("qr_scan.detector 'zbar' is not supported "
+                                    "(ZBar is not linked); use opencv, aruco or finder");
+
+    std::string known;
+    for (const auto& k : availableQrDetectors()) known += " " + k;
+    throw std::invalid_argument("unknown qr_scan.detector '" + kind +
+                                "' (available:" + known + ")");
+}
+
+std::vector<std::string> availableQrDetectors() {
+    return {
+        "opencv",
+#ifdef QRSLAM_HAVE_QR_ARUCO
+        "aruco",
+#endif
+        "finder",
+    };
+}
+
+} // namespace qrslam
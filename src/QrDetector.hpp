@@ -0,0 +1,45 @@
+#pragma once
+/**
+ * @file   QrDetector.hpp
+ * @brief  Интерфейс детектора QR-кодов и фабрика бэкендов.
+ *
+ *  Бэкенды (qr_scan.detector в app.yaml):
+ *    • "opencv" — cv::QRCodeDetector (детекция + декодирование);
+ *    • "aruco"  — cv::QRCodeDetectorAruco (OpenCV ≥ 4.8);
+ *    • "finder" — собственный сканер: SIMD-адаптивный порог + поиск
+ *                 finder-паттернов 1:1:3:1:1, декодирование через OpenCV.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "MarkerTracker.hpp"   // QrDetection
+
+namespace qrslam {
+
+class QrDetector {
+public:
+    virtual ~QrDetector() = default;
+
+    /**
+     * @brief  Найти и декодировать QR-коды на 8-битном сером кадре.
+     * @param  out  очищается и заполняется; ёмкость переиспользуется
+     *              между кадрами. Углы: TL, TR, BR, BL.
+     */
+    virtual void detect(const cv::Mat& gray, std::vector<QrDetection>& out) = 0;
+
+    /// имя бэкенда, как в конфиге
+    virtual const char* name() const = 0;
+};
+
+/// Создать бэкенд по имени; std::invalid_argument для неизвестного.
+std::unique_ptr<QrDetector> makeQrDetector(const std::string& kind);
+
+/// Все бэкенды, доступные в этой сборке (для бенчмарка).
+std::vector<std::string> availableQrDetectors();
+
+} // namespace qrslam
@@ -0,0 +1,337 @@
+/**
+ * @file   QrFinderScanner.cpp
+ */
+#include "QrFinderScanner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace qrslam {
+
+namespace {
+
+constexpr std::size_t kMaxFinders = 24;  // верхняя граница для перебора троек
+
+/// Пропорции 1:1:3:1:1 с допуском tol (в долях модуля).
+bool ratioOk(const int st[5], double tol) {
+    int total = 0;
+    for (int i = 0; i < 5; ++i) {
+        if (st[i] == 0) return false;
+        total += st[i];
+    }
+    if (total < 7) return false;
+    const double m   = total / 7.0;
+    const double var = m * tol;
+    return std::abs(m     - st[0]) < var   &&
+           std::abs(m     - st[1]) < var   &&
+           std::abs(3 * m - st[2]) < 3*var &&
+           std::abs(m     - st[3]) < var   &&
+           std::abs(m     - st[4]) < var;
+}
+
+#if CV_SIMD
+/// 0xFF там, где g < m − off (вычитание с насыщением)
+inline cv::v_uint8 darkMask(const cv::v_uint8& g, const cv::v_uint8& m,
+                            const cv::v_uint8& off) {
+#if (CV_VERSION_MAJOR > 4) || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)
+    return cv::v_lt(g, cv::v_sub(m, off));
+#else
+    return g < (m - off);
+#endif
+}
+#endif
+
+inline float norm2(const cv::Point2f& v) { return std::sqrt(v.dot(v)); }
+
+/// вершина четырёхугольника, крайняя в направлении dir
+inline const cv::Point2f& extreme(const std::array<cv::Point2f,4>& q, const cv::Point2f& dir) {
+    return *std::max_element(q.begin(), q.end(), [&dir](const cv::Point2f& a,
+                                                        const cv::Point2f& b) {
+        return a.dot(dir) < b.dot(dir);
+    });
+}
+
+/// пересечение прямых a1a2 и b1b2 (однородные координаты); false — параллельны
+bool intersect(const cv::Point2f& a1, const cv::Point2f& a2,
+               const cv::Point2f& b1, const cv::Point2f& b2, cv::Point2f& out) {
+    const cv::Point3f la = cv::Point3f(a1.x, a1.y, 1.f).cross(cv::Point3f(a2.x, a2.y, 1.f));
+    const cv::Point3f lb = cv::Point3f(b1.x, b1.y, 1.f).cross(cv::Point3f(b2.x, b2.y, 1.f));
+    const cv::Point3f p  = la.cross(lb);
+    if (std::abs(p.z) < 1e-6f * (std::abs(p.x) + std::abs(p.y))) return false;
+    out = {p.x / p.z, p.y / p.z};
+    return true;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------
+// public
+// ---------------------------------------------------------------------
+void QrFinderScanner::detect(const cv::Mat& gray, std::vector<QrDetection>& out) {
+    out.clear();
+    CV_Assert(gray.type() == CV_8UC1);
+
+    binarize(gray);
+    finders_.clear();
+    scanRows();
+
+    // шум: оставляем кластеры, подтверждённые несколькими строками
+    finders_.erase(std::remove_if(finders_.begin(), finders_.end(),
+                                  [](const Finder& f) { return f.hits < 2; }),
+                   finders_.end());
+    if (finders_.size() < 3) return;
+
+    std::sort(finders_.begin(), finders_.end(),
+              [](const Finder& a, const Finder& b) { return a.hits > b.hits; });
+    if (finders_.size() > kMaxFinders) finders_.resize(kMaxFinders);
+
+    groupTriples(gray, out);
+}
+
+// ---------------------------------------------------------------------
+// 1) адаптивный порог
+// ---------------------------------------------------------------------
+void QrFinderScanner::binarize(const cv::Mat& gray) {
+    const int bs = p_.block_size | 1;
+    cv::boxFilter(gray, mean_, CV_8U, cv::Size(bs, bs), cv::Point(-1, -1),
+                  true, cv::BORDER_REPLICATE);
+    bin_.create(gray.size(), CV_8UC1);
+
+    const auto off = static_cast<uchar>(std::clamp(p_.offset, 0, 255));
+    for (int y = 0; y < gray.rows; ++y) {
+        const uchar* g = gray.ptr<uchar>(y);
+        const uchar* m = mean_.ptr<uchar>(y);
+        uchar*       b = bin_.ptr<uchar>(y);
+        int x = 0;
+#if CV_SIMD
+        const cv::v_uint8 voff = cv::vx_setall_u8(off);
+        for (; x <= gray.cols - CV_SIMD_WIDTH; x += CV_SIMD_WIDTH) {
+            cv::v_store(b + x, darkMask(cv::vx_load(g + x), cv::vx_load(m + x), voff));
+        }
+#endif
+        for (; x < gray.cols; ++x)
+            b[x] = (g[x] + off < m[x]) ? 255 : 0;
+    }
+}
+
+// ---------------------------------------------------------------------
+// 2) поиск 1:1:3:1:1 по строкам
+// ---------------------------------------------------------------------
+void QrFinderScanner::scanRows() {
+    const int step = std::max(1, p_.row_step);
+
+    for (int y = 0; y < bin_.rows; y += step) {
+        const uchar* row = bin_.ptr<uchar>(y);
+        int st[5] = {0, 0, 0, 0, 0};
+        int cur   = 0;                       // 0,2,4 — тёмные; 1,3 — светлые
+
+        auto tryCandidate = [&](int x_end) {
+            if (!ratioOk(st, p_.ratio_tol)) return;
+            const int total_h = st[0] + st[1] + st[2] + st[3] + st[4];
+            const int cx      = x_end - st[4] - st[3] - st[2] / 2;
+
+            float off_v, total_v;
+            if (!crossCheck(cx, y, 0, 1, st[2], off_v, total_v)) return;
+            if (5 * std::abs(total_v - total_h) >= 2 * total_h) return;
+            const int cy = y + static_cast<int>(off_v);
+
+            float off_h, total_h2;
+            if (!crossCheck(cx, cy, 1, 0, st[2], off_h, total_h2)) return;
+
+            addCandidate(cx + off_h, y + off_v, (total_v + total_h2) / 14.f);
+        };
+
+        for (int x = 0; x < bin_.cols; ++x) {
+            if (row[x]) {                                   // тёмный
+                if (cur & 1) ++cur;
+                ++st[cur];
+            } else if (cur & 1) {                           // светлый → светлый
+                ++st[cur];
+            } else if (st[0] == 0) {
+                // ещё не встретили тёмного
+            } else if (cur == 4) {                          // тёмный → светлый, 5 серий
+                tryCandidate(x);
+                st[0] = st[2]; st[1] = st[3]; st[2] = st[4];
+                st[3] = 1;     st[4] = 0;
+                cur = 3;
+            } else {
+                ++cur;
+                ++st[cur];
+            }
+        }
+        if (cur == 4) tryCandidate(bin_.cols);
+    }
+}
+
+/**
+ * Проверка пропорций вдоль направления (dx,dy) через точку (cx,cy).
+ * center_off — смещение центра средней серии относительно (cx,cy).
+ */
+bool QrFinderScanner::crossCheck(int cx, int cy, int dx, int dy, int max_count,
+                                 float& center_off, float& total) const {
+    auto at = [&](int k) -> int {
+        const int x = cx + k * dx, y = cy + k * dy;
+        if (x < 0 || y < 0 || x >= bin_.cols || y >= bin_.rows) return -1;
+        return bin_.at<uchar>(y, x) ? 1 : 0;
+    };
+
+    int s[5] = {0, 0, 0, 0, 0};
+    int k = 0;
+    while (at(k) == 1) { ++s[2]; --k; }
+    if (at(k) < 0) return false;
+    while (at(k) == 0 && s[1] <= max_count) { ++s[1]; --k; }
+    if (at(k) < 0 || s[1] > max_count) return false;
+    while (at(k) == 1 && s[0] <= max_count) { ++s[0]; --k; }
+    if (s[0] > max_count) return false;
+
+    k = 1;
+    while (at(k) == 1) { ++s[2]; ++k; }
+    if (at(k) < 0) return false;
+    while (at(k) == 0 && s[3] <= max_count) { ++s[3]; ++k; }
+    if (at(k) < 0 || s[3] > max_count) return false;
+    while (at(k) == 1 && s[4] <= max_count) { ++s[4]; ++k; }
+    if (s[4] > max_count) return false;
+
+    if (!ratioOk(s, p_.ratio_tol)) return false;
+    total      = static_cast<float>(s[0] + s[1] + s[2] + s[3] + s[4]);
+    center_off = (k - s[4] - s[3]) - s[2] / 2.f;
+    return true;
+}
+
+void QrFinderScanner::addCandidate(float cx, float cy, float module) {
+    for (auto& f : finders_) {
+        const float tol = std::max(f.module, module) * 2.f;
+        if (std::abs(f.c.x - cx) <= tol && std::abs(f.c.y - cy) <= tol &&
+            std::abs(f.module - module) <= std::max(1.f, f.module * 0.5f)) {
+            const float w = static_cast<float>(f.hits);
+            f.c      = (f.c * w + cv::Point2f(cx, cy)) * (1.f / (w + 1.f));
+            f.module = (f.module * w + module) / (w + 1.f);
+            ++f.hits;
+            return;
+        }
+    }
+    finders_.push_back({cv::Point2f(cx, cy), module, 1});
+}
+
+// ---------------------------------------------------------------------
+// 3-4) тройки → углы → декодирование
+// ---------------------------------------------------------------------
+void QrFinderScanner::groupTriples(const cv::Mat& gray, std::vector<QrDetection>& out) {
+    struct Triple { int tl, tr, bl; float score; };
+    std::vector<Triple> cand;
+
+    const int n = static_cast<int>(finders_.size());
+    for (int i = 0; i < n; ++i)
+    for (int j = i + 1; j < n; ++j)
+    for (int k = j + 1; k < n; ++k) {
+        const int idx[3] = {i, j, k};
+        float mmin = finders_[i].module, mmax = mmin;
+        for (int q : idx) {
+            mmin = std::min(mmin, finders_[q].module);
+            mmax = std::max(mmax, finders_[q].module);
+        }
+        if (mmax > 1.5f * mmin) continue;
+        const float ms = (finders_[i].module + finders_[j].module + finders_[k].module) / 3.f;
+
+        // вершина прямого угла — та, где |cos| минимален
+        for (int a = 0; a < 3; ++a) {
+            const Finder& A = finders_[idx[a]];
+            const Finder& B = finders_[idx[(a + 1) % 3]];
+            const Finder& C = finders_[idx[(a + 2) % 3]];
+            const cv::Point2f ab = B.c - A.c, ac = C.c - A.c;
+            const float d1 = norm2(ab), d2 = norm2(ac);
+            if (d1 < 1.f || d2 < 1.f) continue;
+            if (std::abs(d1 - d2) > 0.25f * std::max(d1, d2)) continue;
+            const float mods = 0.5f * (d1 + d2) / ms;       // 14 (v1) … 154 (v40)
+            if (mods < 12.f || mods > 160.f) continue;
+            const float cosang = std::abs(ab.dot(ac)) / (d1 * d2);
+            if (cosang > 0.2f) continue;
+
+            // ось y вниз: cross(TR−TL, BL−TL) > 0
+            const bool ccw = ab.x * ac.y - ab.y * ac.x > 0;
+            cand.push_back({idx[a],
+                            ccw ? idx[(a + 1) % 3] : idx[(a + 2) % 3],
+                            ccw ? idx[(a + 2) % 3] : idx[(a + 1) % 3],
+                            cosang + std::abs(d1 - d2) / std::max(d1, d2)});
+        }
+    }
+
+    std::sort(cand.begin(), cand.end(),
+              [](const Triple& a, const Triple& b) { return a.score < b.score; });
+
+    std::vector<bool> used(finders_.size(), false);
+    std::array<cv::Point2f,4> qtl, qtr, qbl;
+    for (const Triple& t : cand) {
+        if (used[t.tl] || used[t.tr] || used[t.bl]) continue;
+
+        const Finder& TL = finders_[t.tl];
+        const Finder& TR = finders_[t.tr];
+        const Finder& BL = finders_[t.bl];
+        if (!finderQuad(gray, TL, qtl) || !finderQuad(gray, TR, qtr) ||
+            !finderQuad(gray, BL, qbl))
+            continue;
+
+        // оси кода — только для выбора вершин паттернов, не для углов
+        const cv::Point2f ux = TR.c - TL.c, uy = BL.c - TL.c;
+        cv::Point2f br;
+        if (!intersect(extreme(qtr, ux - uy), extreme(qtr, ux + uy),     // правый край
+                       extreme(qbl, uy - ux), extreme(qbl, ux + uy),     // нижний край
+                       br))
+            continue;
+
+        quad_.assign({extreme(qtl, -ux - uy), extreme(qtr, ux - uy), br, extreme(qbl, uy - ux)});
+        if (!cv::Rect2f(0.f, 0.f, static_cast<float>(gray.cols),
+                        static_cast<float>(gray.rows)).contains(br))
+            continue;
+
+        std::string data = decoder_.decode(gray, quad_);
+        if (data.empty()) continue;
+
+        used[t.tl] = used[t.tr] = used[t.bl] = true;
+        out.push_back({std::move(data), {quad_[0], quad_[1], quad_[2], quad_[3]}});
+    }
+}
+
+/**
+ * Внешний квадрат finder-паттерна: внешнее тёмное кольцо 7×7 модулей со
+ * всех сторон окружено светлым (разделитель / тихая зона), поэтому в окне
+ * bin_ вокруг центра это отдельный внешний контур, содержащий центр.
+ */
+bool QrFinderScanner::finderQuad(const cv::Mat& gray, const Finder& f,
+                                 std::array<cv::Point2f,4>& quad) {
+    const int r = cvCeil(f.module * 6.f);                // 3.5 модуля + запас на наклон
+    const cv::Rect win(cvRound(f.c.x) - r, cvRound(f.c.y) - r, 2 * r + 1, 2 * r + 1);
+    const cv::Rect roi = win & cv::Rect(0, 0, bin_.cols, bin_.rows);
+    if (roi != win) return false;                        // у края кадра — не доверяем
+    bin_(roi).copyTo(roi_);                              // findContours меняет вход (OpenCV < 3.2)
+
+    contours_.clear();
+    cv::findContours(roi_, contours_, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    const cv::Point2f c = f.c - cv::Point2f(static_cast<float>(roi.x), static_cast<float>(roi.y));
+    const double expect = 49.0 * f.module * f.module;
+    for (const auto& ct : contours_) {
+        if (cv::pointPolygonTest(ct, c, false) < 0) continue;
+        const double area = cv::contourArea(ct);
+        if (area < 0.4 * expect || area > 2.5 * expect) return false;
+        cv::approxPolyDP(ct, poly_, 0.04 * cv::arcLength(ct, true), true);
+        if (poly_.size() != 4 || !cv::isContourConvex(poly_)) return false;
+        for (const cv::Point& p : poly_)
+            if (p.x <= 0 || p.y <= 0 || p.x >= roi.width - 1 || p.y >= roi.height - 1)
+                return false;                            // кольцо не влезло в окно
+
+        sub_.clear();
+        for (const cv::Point& p : poly_)
+            sub_.emplace_back(static_cast<float>(p.x + roi.x), static_cast<float>(p.y + roi.y));
+        const int w = std::max(2, cvRound(f.module * 0.5f));
+        cv::cornerSubPix(gray, sub_, cv::Size(w, w), cv::Size(-1, -1),
+                         cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 10, 0.05));
+        std::copy_n(sub_.begin(), 4, quad.begin());
+        return true;
+    }
+    return false;
+}
+
+} // namespace qrslam
@@ -0,0 +1,78 @@
+#pragma once
+/**
+ * @file   QrFinderScanner.hpp
+ * @brief  Быстрый собственный QR-сканер по finder-паттернам.
+ *
+ *  Конвейер:
+ *    1) адаптивный порог: box-среднее (cv::boxFilter) + SIMD-сравнение;
+ *    2) построчный run-length поиск 1:1:3:1:1, перекрёстная проверка
+ *       по вертикали и повторно по горизонтали;
+ *    3) кластеризация центров, подбор троек с прямым углом;
+ *    4) углы кода из контуров трёх finder-паттернов, декодирование
+ *       cv::QRCodeDetector::decode.
+ *
+ *  Углы идут в PnP как есть, поэтому угадывать их нельзя. TL, TR, BL —
+ *  внешние углы finder-паттернов (контур в бинарном кадре → 4 вершины →
+ *  cornerSubPix). BR у кода не отмечен ничем: он — пересечение правого
+ *  края (продолжение внешней стороны TR-паттерна) и нижнего (сторона
+ *  BL-паттерна). Прямые при перспективе остаются прямыми, так что угол
+ *  верен и для наклонного маркера; ошибка — только от экстраполяции
+ *  7-модульных сторон на весь код. Тройка, у которой какой-то паттерн
+ *  не даёт четырёхугольника, отбрасывается, а не достраивается.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <array>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include "QrDetector.hpp"
+
+namespace qrslam {
+
+class QrFinderScanner final : public QrDetector {
+public:
+    struct Params {
+        int    block_size = 31;   ///< окно адаптивного порога (нечётное), px
+        int    offset     = 7;    ///< порог = среднее − offset
+        int    row_step   = 2;    ///< шаг по строкам при поиске паттернов
+        double ratio_tol  = 0.5;  ///< допуск пропорций 1:1:3:1:1 (доля модуля)
+    };
+
+    QrFinderScanner() : QrFinderScanner(Params{}) {}
+    explicit QrFinderScanner(const Params& p) : p_{p} {}
+
+    void detect(const cv::Mat& gray, std::vector<QrDetection>& out) override;
+    const char* name() const override { return "finder"; }
+
+    /// Кандидат finder-паттерна (центр + размер модуля, px).
+    struct Finder {
+        cv::Point2f c;
+        float       module;
+        int         hits;     ///< сколько строк подтвердили кластер
+    };
+
+private:
+    void binarize(const cv::Mat& gray);
+    void scanRows();
+    void addCandidate(float cx, float cy, float module);
+    bool crossCheck(int cx, int cy, int dx, int dy, int max_count,
+                    float& center_off, float& total) const;
+    bool finderQuad(const cv::Mat& gray, const Finder& f,
+                    std::array<cv::Point2f,4>& quad);
+    void groupTriples(const cv::Mat& gray, std::vector<QrDetection>& out);
+
+    Params                p_;
+    cv::Mat               mean_, bin_;        // переиспользуемые буферы
+    std::vector<Finder>   finders_;
+    std::vector<cv::Point2f> quad_;
+    cv::Mat               roi_;               // finderQuad: копия окна bin_
+    std::vector<std::vector<cv::Point>> contours_;
+    std::vector<cv::Point>   poly_;
+    std::vector<cv::Point2f> sub_;
+    cv::QRCodeDetector    decoder_;
+};
+
+} // namespace qrslam
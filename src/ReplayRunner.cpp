@@ -0,0 +1,174 @@
+/**
+ * @file   ReplayRunner.cpp
+ */
+#include "ReplayRunner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <openvslam/config.h>
+#include <openvslam/system.h>
+#include <openvslam/camera/base.h>
+#include <openvslam/publish/frame_publisher.h>
+
+#include <opencv2/imgproc.hpp>
+#include <spdlog/spdlog.h>
+
+#include "MarkerTracker.hpp"
+#include "QrDetector.hpp"
+#include "SessionLog.hpp"
+
+namespace qrslam {
+
+namespace {
+
+/// CPU-время (мс) процесса или вызывающего потока (POSIX clock_gettime).
+double cpuMs(clockid_t clk) {
+    timespec ts{};
+    clock_gettime(clk, &ts);
+    return static_cast<double>(ts.tv_sec) * 1e3 + static_cast<double>(ts.tv_nsec) * 1e-6;
+}
+
+} // namespace
+
+ReplayRunner::ReplayRunner(Params p) : p_{std::move(p)} {
+    camera_ = YAML::LoadFile(p_.camera_yaml);
+
+    // лог проверяем сразу, а не на первом прогоне сетки
+    const SessionReader probe(p_.session_path);
+    if (probe.numFrames() == 0)
+        throw std::runtime_error("No frames in " + p_.session_path);
+}
+
+ReplayRunner::Metrics ReplayRunner::run(const Settings& s) const {
+    using clock = std::chrono::steady_clock;
+
+    // --- SLAM с переопределёнными ORB-параметрами ---------------------
+    YAML::Node node = YAML::Clone(camera_);
+    node["Feature.max_num_keypoints"] = s.max_num_keypoints;
+    node["Feature.num_levels"]        = s.num_levels;
+    node["Feature.scale_factor"]      = s.scale_factor;
+
+    auto cfg = std::make_shared<openvslam::config>(node, p_.camera_yaml);
+    openvslam::system slam(cfg, p_.vocab_path);
+    if (s.localization) {
+        if (!slam.load_map_database(p_.map_path))
+            throw std::runtime_error("Cannot load map " + p_.map_path);
+        slam.startup(false);
+        slam.disable_mapping_module();
+    } else {
+        slam.startup();
+    }
+
+    const auto& cam = cfg->camera_;
+    const bool   rgbd         = cam->setup_type_ == openvslam::camera::setup_type_t::RGBD;
+    const double depth_factor = node["depthmap_factor"].as<double>(1.0);
+    MarkerTracker tracker(
+        MarkerTracker::CameraIntrinsics{cam->fx_, cam->fy_, cam->cx_, cam->cy_});
+    tracker.setCameraModel(geom::cameraModelFromConfig(
+        node, static_cast<int>(cam->cols_), static_cast<int>(cam->rows_)));
+    if (s.localization) {
+        // ошибка маркеров — против базы, снятой вместе с картой
+        if (!p_.marker_db.empty() && !tracker.load(p_.marker_db))
+            throw std::runtime_error("Cannot load marker DB " + p_.marker_db);
+        tracker.setReadOnly(true);
+    }
+    const auto qrdet = makeQrDetector(p_.qr_detector);
+
+    SessionReader reader(p_.session_path);
+    if (p_.t_begin > 0.0) reader.seek(p_.t_begin);
+
+    // --- прогон ---------------------------------------------------------
+    Metrics                  m;
+    SessionFrame             fr;
+    cv::Mat                  rgb, gray;
+    std::vector<QrDetection> dets;
+    std::vector<double>      track_ms;
+    std::size_t              lost    = 0;
+    double                   err_sum = 0.0;
+
+    double       cpu_reader = 0.0;                 // распаковка лога — не конвейер
+    const double cpu0       = cpuMs(CLOCK_PROCESS_CPUTIME_ID);
+    const auto   wall0      = clock::now();
+    double       ts0        = -1.0;
+
+    while (true) {
+        const double r0 = cpuMs(CLOCK_THREAD_CPUTIME_ID);
+        const bool   ok = reader.next(fr);
+        cpu_reader += cpuMs(CLOCK_THREAD_CPUTIME_ID) - r0;
+        if (!ok || (p_.t_end > 0.0 && fr.ts > p_.t_end)) break;
+        if (fr.bgr.empty()) continue;              // битый кадр в логе
+
+        if (ts0 < 0.0) ts0 = fr.ts;
+        if (p_.realtime) {
+            // как в поле: локальному маппингу даётся реальное время
+            std::this_thread::sleep_until(
+                wall0 + std::chrono::duration_cast<clock::duration>(
+                            std::chrono::duration<double>(fr.ts - ts0)));
+        }
+
+        cv::cvtColor(fr.bgr, rgb, cv::COLOR_BGR2RGB);
+        const auto t0 = clock::now();
+        const Eigen::Matrix4d T_cw = rgbd && !fr.depth.empty()
+            ? slam.feed_RGBD_frame(rgb, fr.depth, fr.ts)
+            : slam.feed_monocular_frame(rgb, fr.ts);
+        track_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - t0).count());
+
+        const bool tracking = slam.get_frame_publisher()->get_tracking_state() == "Tracking";
+        if (!tracking) ++lost;
+
+        if (s.qr_interval > 0 && m.frames % static_cast<std::size_t>(s.qr_interval) == 0) {
+            cv::cvtColor(fr.bgr, gray, cv::COLOR_BGR2GRAY);
+            qrdet->detect(gray, dets);
+            if (tracking && !dets.empty()) {
+                // ошибку считаем до обновления: поза с прошлого скана vs сейчас
+                for (const auto& d : dets) {
+                    if (const auto e = tracker.reprojectionError(d, T_cw)) {
+                        err_sum += *e;
+                        ++m.marker_obs;
+                    }
+                }
+                if (rgbd && !fr.depth.empty())
+                    tracker.addDetectionsRgbd(dets, fr.depth, depth_factor, T_cw, p_.marker_size);
+                else
+                    tracker.addDetections(dets, T_cw, p_.marker_size);
+            }
+        }
+        ++m.frames;
+    }
+    const double cpu_total = cpuMs(CLOCK_PROCESS_CPUTIME_ID) - cpu0 - cpu_reader;
+    slam.shutdown();
+
+    // --- метрики --------------------------------------------------------
+    if (m.frames > 0) {
+        const double n = static_cast<double>(m.frames);
+        m.cpu_ms     = cpu_total / n;
+        m.lost_ratio = static_cast<double>(lost) / n;
+
+        double sum = 0.0;
+        for (double t : track_ms) sum += t;
+        m.track_ms_mean = sum / static_cast<double>(track_ms.size());
+        const auto k = static_cast<std::size_t>(0.95 * static_cast<double>(track_ms.size() - 1));
+        std::nth_element(track_ms.begin(), track_ms.begin() + static_cast<std::ptrdiff_t>(k),
+                         track_ms.end());
+        m.track_ms_p95 = track_ms[k];
+    }
+    m.marker_err_px = m.marker_obs > 0 ? err_sum / static_cast<double>(m.marker_obs)
+                                       : std::numeric_limits<double>::quiet_NaN();
+
+    spdlog::info("[Replay] {} kp={} levels={} scale={} qr={}: {} frames, cpu {:.2f} ms, "
+                 "lost {:.1f}%, marker err {:.2f} px ({} obs)",
+                 s.localization ? "localization" : "slam",
+                 s.max_num_keypoints, s.num_levels, s.scale_factor, s.qr_interval,
+                 m.frames, m.cpu_ms, m.lost_ratio * 100, m.marker_err_px, m.marker_obs);
+    return m;
+}
+
+} // namespace qrslam
@@ -0,0 +1,78 @@
+#pragma once
+/**
+ * @file   ReplayRunner.hpp
+ * @brief  Безголовый прогон записанной сессии (SessionLog) через конвейер
+ *         SLAM + QR с заданными настройками и сбором метрик.
+ *
+ *  Каждый run() поднимает свежую openvslam::system с camera.yaml, в котором
+ *  переопределены ORB-параметры, — прогоны независимы и сравнимы.
+ *  Settings::localization — вместо SLAM с нуля загружается готовая карта
+ *  (Params::map_path), mapping выключен, маркеры — из базы, только чтение:
+ *  сравнение CPU и задержки режима локализации с полным SLAM.
+ *
+ *  Метрики:
+ *   - cpu_ms      — CPU процесса на кадр (все потоки SLAM + QR), без
+ *                   распаковки лога;
+ *   - track_ms    — стена feed_*_frame (задержка потока кадров);
+ *   - lost_ratio  — доля кадров не в состоянии "Tracking" (инициализация
+ *                   тоже считается потерей);
+ *   - marker_err  — RMS-ошибка (px) углов уже известного маркера,
+ *                   спроецированного по текущей T_cw, против детекции.
+ *                   Не зависит от масштаба монокулярной карты.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <cstddef>
+#include <string>
+
+#include <yaml-cpp/yaml.h>
+
+namespace qrslam {
+
+class ReplayRunner {
+public:
+    struct Params {
+        std::string session_path;            ///< лог SessionWriter
+        std::string camera_yaml;             ///< базовый camera.yaml
+        std::string vocab_path;              ///< ORB словарь .fbow
+        std::string qr_detector = "opencv";
+        double      marker_size = 0.040;     ///< м
+        bool        realtime    = true;      ///< темп подачи — по меткам записи
+        double      t_begin     = 0.0;       ///< начало отрезка (seek по индексу)
+        double      t_end       = 0.0;       ///< 0 = до конца лога
+        std::string map_path;                ///< карта для Settings::localization
+        std::string marker_db;               ///< база маркеров к ней (опц.)
+    };
+
+    /// Настраиваемые параметры одного прогона.
+    struct Settings {
+        int    max_num_keypoints = 1000;     ///< Feature.max_num_keypoints
+        int    num_levels        = 8;        ///< Feature.num_levels
+        double scale_factor      = 1.2;      ///< Feature.scale_factor
+        int    qr_interval       = 2;        ///< qr_scan.interval_frame
+        bool   localization      = false;    ///< готовая карта, без mapping
+    };
+
+    struct Metrics {
+        std::size_t frames        = 0;
+        double      cpu_ms        = 0.0;     ///< CPU процесса / кадр
+        double      track_ms_mean = 0.0;
+        double      track_ms_p95  = 0.0;
+        double      lost_ratio    = 0.0;
+        double      marker_err_px = 0.0;     ///< NaN — повторных наблюдений нет
+        std::size_t marker_obs    = 0;       ///< повторных наблюдений маркеров
+    };
+
+    /// @throws std::runtime_error / YAML::Exception при ошибке файлов
+    explicit ReplayRunner(Params p);
+
+    Metrics run(const Settings& s) const;
+
+    const Params& params() const { return p_; }
+
+private:
+    Params     p_;
+    YAML::Node camera_;                      // базовый camera.yaml
+};
+
+} // namespace qrslam
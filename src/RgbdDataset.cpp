@@ -0,0 +1,58 @@
+/**
+ * @file   RgbdDataset.cpp
+ */
+#include "RgbdDataset.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <opencv2/imgcodecs.hpp>
+#include <spdlog/spdlog.h>
+
+namespace qrslam {
+
+RgbdDataset::RgbdDataset(std::string dir, const std::string& associations)
+    : dir_{std::move(dir)} {
+    const std::string path = dir_ + "/" + associations;
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open RGB-D associations " + path);
+
+    for (std::string line; std::getline(in, line);) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        Entry e;
+        double ts_depth = 0.0;
+        if (ss >> e.ts >> e.rgb >> ts_depth >> e.depth)
+            entries_.push_back(std::move(e));
+    }
+    if (entries_.empty())
+        throw std::runtime_error("No frames in " + path);
+
+    spdlog::info("[RgbdDataset] {} frames from {}", entries_.size(), dir_);
+}
+
+bool RgbdDataset::next(cv::Mat& bgr, cv::Mat& depth, double& timestamp) {
+    while (pos_ < entries_.size()) {
+        const Entry& e = entries_[pos_++];
+        bgr   = cv::imread(dir_ + "/" + e.rgb,   cv::IMREAD_COLOR);
+        depth = cv::imread(dir_ + "/" + e.depth, cv::IMREAD_UNCHANGED);
+        if (bgr.empty() || depth.empty()) {
+            spdlog::warn("[RgbdDataset] skip unreadable frame {}", e.rgb);
+            continue;
+        }
+        timestamp = e.ts;
+        return true;
+    }
+    return false;
+}
+
+void RgbdDataset::seek(double ts) {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), ts,
+                               [](const Entry& e, double t) { return e.ts < t; });
+    pos_ = static_cast<std::size_t>(it - entries_.begin());
+}
+
+} // namespace qrslam
@@ -0,0 +1,53 @@
+#pragma once
+/**
+ * @file   RgbdDataset.hpp
+ * @brief  Проигрывание записанных RGB-D последовательностей с диска.
+ *
+ *  Формат — как у TUM RGB-D: файл ассоциаций, по строке на кадр
+ *
+ *      <ts_rgb> rgb/xxx.png <ts_depth> depth/xxx.png
+ *
+ *  (строки с '#' — комментарии). Пути — относительно каталога набора.
+ *  Глубина читается как есть (обычно CV_16UC1), масштаб задаётся
+ *  depthmap_factor в camera.yaml.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace qrslam {
+
+class RgbdDataset {
+public:
+    /**
+     * @param dir           каталог набора
+     * @param associations  имя файла ассоциаций внутри dir
+     * @throws std::runtime_error, если файл не найден или пуст
+     */
+    explicit RgbdDataset(std::string dir,
+                         const std::string& associations = "associations.txt");
+
+    /// Следующий кадр; false — набор закончился.
+    bool next(cv::Mat& bgr, cv::Mat& depth, double& timestamp);
+
+    /// Перейти к первому кадру с меткой >= ts.
+    void seek(double ts);
+
+    std::size_t size()     const { return entries_.size(); }
+    std::size_t position() const { return pos_; }
+
+private:
+    struct Entry {
+        double      ts;
+        std::string rgb, depth;
+    };
+
+    std::string        dir_;
+    std::vector<Entry> entries_;
+    std::size_t        pos_ = 0;
+};
+
+} // namespace qrslam
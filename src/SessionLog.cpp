@@ -0,0 +1,595 @@
+/**
+ * @file   SessionLog.cpp
+ */
+#include "SessionLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace qrslam {
+
+namespace {
+
+// ---------------------------------------------------------------------
+// формат на диске
+// ---------------------------------------------------------------------
+constexpr char          kFileMagic[8]  = {'Q', 'R', 'S', 'L', 'O', 'G', '0', '1'};
+constexpr char          kIndexMagic[8] = {'Q', 'R', 'S', 'I', 'D', 'X', '0', '1'};
+constexpr std::uint32_t kChunkMagic    = 0x4B4E4843;     // "CHNK"
+constexpr std::uint32_t kVersion       = 1;
+
+constexpr std::uint8_t kCodecRaw = 0;
+constexpr std::uint8_t kCodecLz  = 1;
+
+constexpr std::uint8_t kFrame = 1, kDepth = 2, kPose = 3, kDetections = 4;
+
+/// сжатие не окупилось (stored > raw·kMinGain) → пауза, растущая до kMaxBackoff кадров
+constexpr double   kMinGain    = 0.9;
+constexpr unsigned kMaxBackoff = 64;
+
+struct FileHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+};
+struct ChunkHeader {
+    std::uint32_t magic;
+    std::uint32_t records;
+    std::uint64_t payload;       ///< байт записей за заголовком
+    double        t_first;
+    double        t_last;
+};
+struct RecordHeader {
+    std::uint8_t  kind;
+    std::uint8_t  codec;
+    std::uint16_t aux;           ///< Pose: PoseSource; остальные — 0
+    std::uint32_t size;          ///< байт за заголовком
+    std::uint64_t frame_id;
+    double        ts;
+};
+struct ImageMeta {
+    std::int32_t  rows, cols, type;
+    std::uint32_t raw_bytes;
+};
+struct Footer {
+    std::uint64_t index_offset;
+    std::uint32_t chunks;
+    std::uint32_t reserved;
+    char          magic[8];
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(ChunkHeader) == 32 &&
+              sizeof(RecordHeader) == 24 && sizeof(ImageMeta) == 16 &&
+              sizeof(Footer) == 24 && sizeof(SessionIndexEntry) == 32,
+              "session log layout must not depend on padding");
+
+constexpr std::size_t kPoseBytes = 16 * sizeof(double);   // Eigen, column-major
+
+template <class T>
+void put(std::vector<std::uint8_t>& v, const T& x) {
+    const auto* p = reinterpret_cast<const std::uint8_t*>(&x);
+    v.insert(v.end(), p, p + sizeof(T));
+}
+
+} // namespace
+
+// =====================================================================
+// SessionWriter
+// =====================================================================
+SessionWriter::SessionWriter(Params p) : p_{std::move(p)} {
+    if (p_.queue == 0) p_.queue = 1;
+    file_ = std::fopen(p_.path.c_str(), "wb");
+    if (!file_)
+        throw std::runtime_error("Cannot open session log " + p_.path);
+
+    FileHeader h{};
+    std::memcpy(h.magic, kFileMagic, sizeof(h.magic));
+    h.version = kVersion;
+    std::fwrite(&h, sizeof(h), 1, file_);
+    offset_ = sizeof(h);
+
+    buf_cap_ = p_.chunk_bytes;
+    buf_.reset(new std::uint8_t[buf_cap_]);        // без обнуления
+
+    spdlog::info("[SessionWriter] recording {} (lz: {}, chunk {} MB)",
+                 p_.path, p_.compress ? "on" : "off", p_.chunk_bytes >> 20);
+    worker_ = std::thread(&SessionWriter::writeLoop, this);
+}
+
+SessionWriter::~SessionWriter() { stop(); }
+
+// ---------------------------------------------------------------------
+// цикл кадров
+// ---------------------------------------------------------------------
+cv::Mat SessionWriter::takeBuffer(const cv::Mat& src) {
+    auto it = std::find_if(pool_.begin(), pool_.end(), [&](const cv::Mat& m) {
+        return m.size() == src.size() && m.type() == src.type();
+    });
+    if (it == pool_.end()) return cv::Mat();
+    cv::Mat m = std::move(*it);
+    pool_.erase(it);
+    return m;
+}
+
+bool SessionWriter::pushFrame(std::uint64_t frame_id, double ts,
+                              const cv::Mat& bgr, const cv::Mat& depth) {
+    if (bgr.empty()) return false;
+
+    cv::Mat img, dimg;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_) return false;
+        last_ts_ = ts;
+        if (queued_frames_ >= p_.queue) {
+            ++stats_.dropped;
+            dropped_id_ = frame_id;                // поза и детекции тоже не нужны
+            return false;
+        }
+        img = takeBuffer(bgr);
+        if (!depth.empty()) dimg = takeBuffer(depth);
+    }
+
+    // копия вне замка: кадр дальше рисуется overlay'ем, а буфер из пула
+    // того же размера не перевыделяется
+    bgr.copyTo(img);
+    if (!depth.empty()) depth.copyTo(dimg);
+
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_) return false;
+        queue_.push_back(Item{Kind::Frame, frame_id, ts, std::move(img), {}, {}});
+        if (!dimg.empty())
+            queue_.push_back(Item{Kind::Depth, frame_id, ts, std::move(dimg), {}, {}});
+        ++queued_frames_;
+        stats_.queue_hwm = std::max(stats_.queue_hwm, queued_frames_);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void SessionWriter::pushPose(std::uint64_t frame_id, const Eigen::Matrix4d& T_cw,
+                             PoseSource src) {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_ || frame_id == dropped_id_) return;
+        queue_.push_back(Item{Kind::Pose, frame_id, last_ts_, cv::Mat(), T_cw, {}, src});
+    }
+    cv_.notify_one();
+}
+
+void SessionWriter::pushDetections(std::uint64_t frame_id,
+                                   const std::vector<QrDetection>& dets) {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_ || frame_id == dropped_id_) return;
+        queue_.push_back(Item{Kind::Detections, frame_id, last_ts_, cv::Mat(), {}, dets});
+    }
+    cv_.notify_one();
+}
+
+void SessionWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_ && !worker_.joinable()) return;
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+SessionWriter::Stats SessionWriter::stats() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return stats_;
+}
+
+// ---------------------------------------------------------------------
+// поток писателя
+// ---------------------------------------------------------------------
+void SessionWriter::writeLoop() {
+    while (true) {
+        Item        it;
+        std::size_t backlog = 0;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) break;                 // stop_ и всё дописано
+            it = std::move(queue_.front());
+            queue_.pop_front();
+            if (it.kind == Kind::Frame) --queued_frames_;
+            backlog = queued_frames_;
+        }
+
+        Stats d;
+        writeItem(it, backlog, d);
+
+        std::lock_guard<std::mutex> lk(m_);
+        stats_.frames       += d.frames;
+        stats_.compressed   += d.compressed;
+        stats_.raw_bytes    += d.raw_bytes;
+        stats_.stored_bytes += d.stored_bytes;
+        stats_.chunks        = static_cast<std::uint32_t>(index_.size());
+        if (!it.img.empty() && pool_.size() < 2 * p_.queue + 2)
+            pool_.push_back(std::move(it.img));        // буфер вернётся в pushFrame
+    }
+
+    flushChunk();
+    writeIndex();
+    std::fclose(file_);
+    file_ = nullptr;
+
+    std::lock_guard<std::mutex> lk(m_);
+    stats_.chunks = static_cast<std::uint32_t>(index_.size());
+    spdlog::info("[SessionWriter] closed {}: {} frames, {} chunks, {:.1f} MB",
+                 p_.path, stats_.frames, stats_.chunks, stats_.stored_bytes / 1e6);
+}
+
+void SessionWriter::writeItem(const Item& it, std::size_t backlog, Stats& d) {
+    switch (it.kind) {
+        case Kind::Frame:
+            // чанк закрывается только перед кадром: записи кадра не рвутся
+            if (buf_used_ >= p_.chunk_bytes) flushChunk();
+            if (chunk_records_ == 0) chunk_t0_ = it.ts;
+            chunk_t1_ = it.ts;
+            ++chunk_frames_;
+            ++d.frames;
+            appendImage(it.kind, it.frame_id, it.ts, it.img, backlog, d);
+            break;
+
+        case Kind::Depth:
+            appendImage(it.kind, it.frame_id, it.ts, it.img, backlog, d);
+            break;
+
+        case Kind::Pose:
+            appendRecord(it.kind, it.frame_id, it.ts, it.T_cw.data(), kPoseBytes, d,
+                         static_cast<std::uint16_t>(it.pose_src));
+            break;
+
+        case Kind::Detections: {
+            // u32 count, затем на детекцию: u16 len, id, 8 × f32 (углы TL,TR,BR,BL)
+            scratch_.clear();
+            put(scratch_, static_cast<std::uint32_t>(it.dets.size()));
+            for (const auto& det : it.dets) {
+                const auto len = static_cast<std::uint16_t>(
+                    std::min<std::size_t>(det.id.size(), 0xFFFF));
+                put(scratch_, len);
+                scratch_.insert(scratch_.end(), det.id.begin(), det.id.begin() + len);
+                for (const auto& c : det.corners_px) {
+                    put(scratch_, c.x);
+                    put(scratch_, c.y);
+                }
+            }
+            appendRecord(it.kind, it.frame_id, it.ts, scratch_.data(), scratch_.size(), d);
+            break;
+        }
+    }
+}
+
+void SessionWriter::appendImage(Kind kind, std::uint64_t id, double ts,
+                                const cv::Mat& img, std::size_t backlog, Stats& d) {
+    const std::size_t raw = img.total() * img.elemSize();     // copyTo → непрерывный
+    const ImageMeta   meta{img.rows, img.cols, img.type(), static_cast<std::uint32_t>(raw)};
+
+    // не успеваем (очередь за половиной) или недавно не сжалось → как есть
+    bool try_lz = p_.compress && backlog <= p_.queue / 2;
+    if (try_lz && lz_skip_ > 0) {
+        --lz_skip_;
+        try_lz = false;
+    }
+
+    constexpr std::size_t kHead = sizeof(RecordHeader) + sizeof(ImageMeta);
+    std::uint8_t* rec  = reserveTail(kHead + util::LzCodec::bound(raw));
+    std::uint8_t* body = rec + kHead;
+
+    std::uint8_t codec  = kCodecRaw;
+    std::size_t  stored = raw;
+    if (try_lz) {
+        const std::size_t n = lz_.compress(img.data, raw, body, util::LzCodec::bound(raw));
+        if (n > 0 && static_cast<double>(n) <= kMinGain * static_cast<double>(raw)) {
+            codec  = kCodecLz;
+            stored = n;
+            lz_backoff_ = 1;
+            ++d.compressed;
+        } else {
+            lz_skip_    = lz_backoff_;
+            lz_backoff_ = std::min(lz_backoff_ * 2, kMaxBackoff);
+        }
+    }
+    if (codec == kCodecRaw) std::memcpy(body, img.data, raw);
+
+    const RecordHeader h{static_cast<std::uint8_t>(kind), codec, 0,
+                         static_cast<std::uint32_t>(sizeof(ImageMeta) + stored), id, ts};
+    std::memcpy(rec, &h, sizeof(h));
+    std::memcpy(rec + sizeof(h), &meta, sizeof(meta));
+    buf_used_ += kHead + stored;
+    ++chunk_records_;
+    d.raw_bytes    += kHead + raw;
+    d.stored_bytes += kHead + stored;
+}
+
+void SessionWriter::appendRecord(Kind kind, std::uint64_t id, double ts,
+                                 const void* payload, std::size_t n, Stats& d,
+                                 std::uint16_t aux) {
+    const RecordHeader h{static_cast<std::uint8_t>(kind), kCodecRaw, aux,
+                         static_cast<std::uint32_t>(n), id, ts};
+    std::uint8_t* rec = reserveTail(sizeof(h) + n);
+    std::memcpy(rec, &h, sizeof(h));
+    if (n > 0) std::memcpy(rec + sizeof(h), payload, n);
+    buf_used_ += sizeof(h) + n;
+    ++chunk_records_;
+    d.raw_bytes    += sizeof(h) + n;
+    d.stored_bytes += sizeof(h) + n;
+}
+
+std::uint8_t* SessionWriter::reserveTail(std::size_t n) {
+    if (buf_used_ + n > buf_cap_) {
+        const std::size_t cap = std::max(buf_cap_ * 2, buf_used_ + n);
+        std::unique_ptr<std::uint8_t[]> grown(new std::uint8_t[cap]);
+        std::memcpy(grown.get(), buf_.get(), buf_used_);
+        buf_     = std::move(grown);
+        buf_cap_ = cap;
+    }
+    return buf_.get() + buf_used_;
+}
+
+void SessionWriter::flushChunk() {
+    if (chunk_records_ == 0) return;
+
+    const ChunkHeader h{kChunkMagic, chunk_records_, buf_used_, chunk_t0_, chunk_t1_};
+    const bool ok = std::fwrite(&h, sizeof(h), 1, file_) == 1 &&
+                    std::fwrite(buf_.get(), 1, buf_used_, file_) == buf_used_;
+    if (!ok && !io_error_) {
+        spdlog::error("[SessionWriter] write failed: {}", p_.path);
+        io_error_ = true;
+    }
+
+    index_.push_back(SessionIndexEntry{offset_, chunk_t0_, chunk_t1_,
+                                       chunk_records_, chunk_frames_});
+    offset_       += sizeof(h) + buf_used_;
+    buf_used_      = 0;
+    chunk_records_ = 0;
+    chunk_frames_  = 0;
+}
+
+void SessionWriter::writeIndex() {
+    Footer f{offset_, static_cast<std::uint32_t>(index_.size()), 0, {}};
+    std::memcpy(f.magic, kIndexMagic, sizeof(f.magic));
+    std::fwrite(index_.data(), sizeof(SessionIndexEntry), index_.size(), file_);
+    std::fwrite(&f, sizeof(f), 1, file_);
+}
+
+// =====================================================================
+// SessionReader
+// =====================================================================
+struct SessionReader::RecordView {
+    RecordHeader        h;
+    const std::uint8_t* payload;
+};
+
+SessionReader::SessionReader(const std::string& path)
+    : in_(path, std::ios::binary) {
+    if (!in_)
+        throw std::runtime_error("Cannot open session log " + path);
+
+    FileHeader fh{};
+    if (!in_.read(reinterpret_cast<char*>(&fh), sizeof(fh)) ||
+        std::memcmp(fh.magic, kFileMagic, sizeof(fh.magic)) != 0)
+        throw std::runtime_error(path + " is not a session log");
+    if (fh.version != kVersion)
+        throw std::runtime_error("Unsupported session log version " +
+                                 std::to_string(fh.version));
+
+    in_.seekg(0, std::ios::end);
+    const auto size = static_cast<std::uint64_t>(in_.tellg());
+
+    bool ok = false;
+    if (size >= sizeof(FileHeader) + sizeof(Footer)) {
+        Footer f{};
+        in_.seekg(static_cast<std::streamoff>(size - sizeof(Footer)));
+        in_.read(reinterpret_cast<char*>(&f), sizeof(f));
+        ok = in_ && std::memcmp(f.magic, kIndexMagic, sizeof(f.magic)) == 0 &&
+             f.index_offset + std::uint64_t{f.chunks} * sizeof(SessionIndexEntry) +
+                 sizeof(Footer) == size;
+        if (ok) {
+            index_.resize(f.chunks);
+            in_.seekg(static_cast<std::streamoff>(f.index_offset));
+            in_.read(reinterpret_cast<char*>(index_.data()),
+                     static_cast<std::streamsize>(index_.size() * sizeof(SessionIndexEntry)));
+            ok = static_cast<bool>(in_);
+        }
+    }
+    if (!ok) {
+        in_.clear();
+        index_.clear();
+        rebuildIndex(size);
+        recovered_ = true;
+        spdlog::warn("[SessionReader] {}: no index (recording interrupted?), "
+                     "recovered {} chunks", path, index_.size());
+    }
+
+    for (const auto& e : index_) num_frames_ += e.frames;
+    spdlog::info("[SessionReader] {}: {} frames in {} chunks, t = {:.3f} .. {:.3f}",
+                 path, num_frames_, index_.size(), beginTs(), endTs());
+}
+
+void SessionReader::rebuildIndex(std::uint64_t file_size) {
+    std::uint64_t off = sizeof(FileHeader);
+    while (off + sizeof(ChunkHeader) <= file_size) {
+        ChunkHeader h{};
+        in_.seekg(static_cast<std::streamoff>(off));
+        if (!in_.read(reinterpret_cast<char*>(&h), sizeof(h)) || h.magic != kChunkMagic ||
+            off + sizeof(h) + h.payload > file_size)
+            break;                                     // оборванный хвост
+
+        chunk_.resize(h.payload);
+        if (!in_.read(reinterpret_cast<char*>(chunk_.data()),
+                      static_cast<std::streamsize>(h.payload)))
+            break;
+
+        std::uint32_t frames = 0;
+        for (std::size_t p = 0; chunk_.size() - p >= sizeof(RecordHeader);) {
+            RecordHeader r;
+            std::memcpy(&r, chunk_.data() + p, sizeof(r));
+            frames += r.kind == kFrame;
+            p += sizeof(r) + std::min<std::size_t>(r.size, chunk_.size() - p - sizeof(r));
+        }
+        index_.push_back(SessionIndexEntry{off, h.t_first, h.t_last, h.records, frames});
+        off += sizeof(h) + h.payload;
+    }
+    in_.clear();
+    chunk_.clear();
+}
+
+bool SessionReader::loadChunk(std::size_t i) {
+    chunk_i_ = i + 1;
+    pos_     = 0;
+    chunk_.clear();
+
+    const auto& e = index_[i];
+    ChunkHeader h{};
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(e.offset));
+    if (in_.read(reinterpret_cast<char*>(&h), sizeof(h)) && h.magic == kChunkMagic) {
+        chunk_.resize(h.payload);
+        if (in_.read(reinterpret_cast<char*>(chunk_.data()),
+                     static_cast<std::streamsize>(h.payload)))
+            return true;
+    }
+    spdlog::warn("[SessionReader] unreadable chunk {} at offset {}", i, e.offset);
+    chunk_.clear();
+    return false;
+}
+
+bool SessionReader::peek(RecordView& r) {
+    while (true) {
+        const std::size_t left = chunk_.size() - pos_;
+        if (left >= sizeof(RecordHeader)) {
+            std::memcpy(&r.h, chunk_.data() + pos_, sizeof(r.h));
+            if (r.h.size <= left - sizeof(RecordHeader)) {
+                r.payload = chunk_.data() + pos_ + sizeof(RecordHeader);
+                return true;
+            }
+            spdlog::warn("[SessionReader] truncated record in chunk {}", chunk_i_ - 1);
+        }
+        if (chunk_i_ >= index_.size()) {
+            pos_ = chunk_.size();
+            return false;
+        }
+        loadChunk(chunk_i_);                           // битый чанк → следующий
+    }
+}
+
+void SessionReader::decodeImage(const RecordView& r, cv::Mat& dst) const {
+    ImageMeta m{};
+    bool ok = r.h.size >= sizeof(m);
+    if (ok) {
+        std::memcpy(&m, r.payload, sizeof(m));
+        ok = m.rows > 0 && m.cols > 0 && m.type >= 0 &&
+             m.type == CV_MAT_TYPE(m.type) && CV_MAT_CN(m.type) <= 4;
+    }
+    if (ok) {
+        dst.create(m.rows, m.cols, m.type);            // тот же размер → без аллокации
+        const std::size_t raw  = dst.total() * dst.elemSize();
+        const std::uint8_t* body = r.payload + sizeof(m);
+        const std::size_t   n    = r.h.size - sizeof(m);
+        ok = raw == m.raw_bytes;
+        if (ok && r.h.codec == kCodecRaw) {
+            ok = n == raw;
+            if (ok) std::memcpy(dst.data, body, raw);
+        } else if (ok) {
+            ok = r.h.codec == kCodecLz && util::LzCodec::decompress(body, n, dst.data, raw);
+        }
+    }
+    if (!ok) {
+        spdlog::warn("[SessionReader] corrupt image in frame {}", r.h.frame_id);
+        dst.release();
+    }
+}
+
+bool SessionReader::next(SessionFrame& out) {
+    RecordView r;
+    // после seek / битых данных может попасться хвост чужого кадра
+    while (true) {
+        if (!peek(r)) return false;
+        if (r.h.kind == kFrame) break;
+        pos_ += sizeof(RecordHeader) + r.h.size;
+    }
+
+    out.frame_id = r.h.frame_id;
+    out.ts       = r.h.ts;
+    out.has_pose = false;
+    out.pose_src = PoseSource::Slam;
+    out.scanned  = false;
+    out.dets.clear();
+    decodeImage(r, out.bgr);
+    pos_ += sizeof(RecordHeader) + r.h.size;
+
+    bool has_depth = false;
+    while (peek(r) && r.h.kind != kFrame && r.h.frame_id == out.frame_id) {
+        switch (r.h.kind) {
+            case kDepth:
+                decodeImage(r, out.depth);
+                has_depth = !out.depth.empty();
+                break;
+            case kPose:
+                if (r.h.size == kPoseBytes) {
+                    std::memcpy(out.T_cw.data(), r.payload, kPoseBytes);
+                    out.pose_src = r.h.aux == static_cast<std::uint16_t>(PoseSource::Markers)
+                                       ? PoseSource::Markers : PoseSource::Slam;
+                    out.has_pose = true;
+                }
+                break;
+            case kDetections: {
+                const std::uint8_t* p   = r.payload;
+                const std::uint8_t* end = r.payload + r.h.size;
+                auto get = [&](void* dst, std::size_t n) {
+                    if (static_cast<std::size_t>(end - p) < n) return false;
+                    std::memcpy(dst, p, n);
+                    p += n;
+                    return true;
+                };
+                std::uint32_t count = 0;
+                bool ok = get(&count, sizeof(count));
+                for (std::uint32_t k = 0; ok && k < count; ++k) {
+                    std::uint16_t len = 0;
+                    if (!(ok = get(&len, sizeof(len)))) break;
+                    QrDetection det;
+                    det.id.resize(len);
+                    ok = get(det.id.data(), len);
+                    for (auto& c : det.corners_px)
+                        ok = ok && get(&c.x, sizeof(float)) && get(&c.y, sizeof(float));
+                    if (ok) out.dets.push_back(std::move(det));
+                }
+                if (!ok) spdlog::warn("[SessionReader] corrupt detections in frame {}",
+                                      out.frame_id);
+                out.scanned = true;
+                break;
+            }
+            default:
+                break;                                 // неизвестный тип — пропуск
+        }
+        pos_ += sizeof(RecordHeader) + r.h.size;
+    }
+    if (!has_depth) out.depth.release();
+    return true;
+}
+
+void SessionReader::seek(double ts) {
+    if (index_.empty()) return;
+
+    // последний чанк с t_first <= ts
+    auto it = std::upper_bound(index_.begin(), index_.end(), ts,
+                               [](double t, const SessionIndexEntry& e) { return t < e.t_first; });
+    chunk_i_ = it == index_.begin() ? 0 : static_cast<std::size_t>(it - index_.begin()) - 1;
+    chunk_.clear();
+    pos_ = 0;
+
+    // кадры раньше ts пропускаются по заголовкам, без распаковки
+    RecordView r;
+    while (peek(r) && (r.h.kind != kFrame || r.h.ts < ts))
+        pos_ += sizeof(RecordHeader) + r.h.size;
+}
+
+} // namespace qrslam
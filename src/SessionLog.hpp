@@ -0,0 +1,219 @@
+#pragma once
+/**
+ * @file   SessionLog.hpp
+ * @brief  Бинарный лог сессии: сырые кадры, метки времени, T_cw, QR-детекции.
+ *
+ *  Нужен для воспроизведения полевых проблем «как видела система».
+ *
+ *  Формат (little-endian):
+ *
+ *      FileHeader
+ *      Chunk*        = ChunkHeader + записи (Frame [Depth] [Pose] [Detections])…
+ *      Index         = IndexEntry × N        (offset и [t_first, t_last] чанка)
+ *      Footer        = index_offset, N, magic
+ *
+ *  Pose — T_cw (16 double), источник позы (PoseSource) — в поле aux
+ *  заголовка записи; у старых логов там 0 = Slam.
+ *
+ *  Каждый чанк начинается с записи Frame, все записи кадра лежат в одном
+ *  чанке — поэтому seek(ts) = бинарный поиск по индексу + один чанк.
+ *  Если запись оборвалась (нет Footer), индекс восстанавливается проходом
+ *  по заголовкам чанков.
+ *
+ *  SessionWriter не блокирует цикл кадров: кадр копируется в буфер из пула
+ *  и уходит в очередь, сериализация, сжатие (util::LzCodec) и запись
+ *  чанками по chunk_bytes — в отдельном потоке. Сжатие оппортунистическое:
+ *  при плохом коэффициенте (шум сенсора) или растущей очереди кадры пишутся
+ *  как есть — так писатель укладывается в одно ядро при 720p60.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <opencv2/core.hpp>
+
+#include "MarkerTracker.hpp"
+#include "utils/Lz.hpp"
+
+namespace qrslam {
+
+/// Запись индекса — один чанк (формат на диске, 32 байта).
+struct SessionIndexEntry {
+    std::uint64_t offset;     ///< смещение ChunkHeader от начала файла
+    double        t_first;    ///< метка первого кадра чанка
+    double        t_last;
+    std::uint32_t records;
+    std::uint32_t frames;
+};
+
+/// Источник позы кадра (пишется вместе с записью Pose).
+enum class PoseSource : std::uint8_t {
+    Slam    = 0,   ///< трекинг SLAM (и все логи, записанные до флага)
+    Markers = 1,   ///< одометрия по маркерам (joint PnP), SLAM не участвовал
+};
+
+/// Один кадр сессии (как его прочитал SessionReader).
+struct SessionFrame {
+    std::uint64_t            frame_id = 0;
+    double                   ts       = 0.0;
+    cv::Mat                  bgr;                ///< сырой кадр камеры
+    cv::Mat                  depth;              ///< пусто, если не RGB-D
+    bool                     has_pose = false;
+    Eigen::Matrix4d          T_cw     = Eigen::Matrix4d::Identity();
+    PoseSource               pose_src = PoseSource::Slam;
+    bool                     scanned  = false;   ///< детектор запускался на кадре
+    std::vector<QrDetection> dets;
+};
+
+//-------------------------------------------------------------
+// Запись
+//-------------------------------------------------------------
+class SessionWriter {
+public:
+    struct Params {
+        std::string path;                         ///< пусто = запись выключена
+        bool        compress    = true;           ///< util::LzCodec для изображений
+        std::size_t chunk_bytes = 16u << 20;      ///< порог закрытия чанка
+        std::size_t queue       = 8;              ///< макс. кадров в очереди
+    };
+
+    struct Stats {
+        std::uint64_t frames       = 0;   ///< записано кадров
+        std::uint64_t dropped      = 0;   ///< отброшено (очередь полна)
+        std::uint64_t compressed   = 0;   ///< изображений, сохранённых сжатыми
+        std::uint64_t raw_bytes    = 0;   ///< объём записей до сжатия
+        std::uint64_t stored_bytes = 0;   ///< записано в файл
+        std::uint32_t chunks       = 0;
+        std::size_t   queue_hwm    = 0;
+    };
+
+    /// @throws std::runtime_error, если файл не открывается
+    explicit SessionWriter(Params p);
+    ~SessionWriter();
+
+    SessionWriter(const SessionWriter&)            = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+
+    /// Копия кадра (и глубины) в очередь. false — кадр отброшен вместе
+    /// с его позой и детекциями.
+    bool pushFrame(std::uint64_t frame_id, double ts,
+                   const cv::Mat& bgr, const cv::Mat& depth = cv::Mat());
+
+    /// Поза кадра frame_id (после pushFrame того же кадра) и её источник.
+    void pushPose(std::uint64_t frame_id, const Eigen::Matrix4d& T_cw,
+                  PoseSource src = PoseSource::Slam);
+
+    /// Результат детектора для кадра frame_id (пустой список тоже пишется).
+    void pushDetections(std::uint64_t frame_id, const std::vector<QrDetection>& dets);
+
+    /// Дописать очередь, индекс и закрыть файл (вызывается и из деструктора).
+    void stop();
+
+    Stats stats() const;
+
+private:
+    enum class Kind : std::uint8_t { Frame = 1, Depth = 2, Pose = 3, Detections = 4 };
+
+    struct Item {
+        Kind                     kind;
+        std::uint64_t            frame_id;
+        double                   ts;
+        cv::Mat                  img;
+        Eigen::Matrix4d          T_cw;
+        std::vector<QrDetection> dets;
+        PoseSource               pose_src = PoseSource::Slam;
+    };
+
+    cv::Mat takeBuffer(const cv::Mat& src);              // под m_
+    void    writeLoop();
+    void    writeItem(const Item& it, std::size_t backlog, Stats& d);
+    void    appendImage(Kind kind, std::uint64_t id, double ts,
+                        const cv::Mat& img, std::size_t backlog, Stats& d);
+    void    appendRecord(Kind kind, std::uint64_t id, double ts,
+                         const void* payload, std::size_t n, Stats& d,
+                         std::uint16_t aux = 0);
+    std::uint8_t* reserveTail(std::size_t n);
+    void    flushChunk();
+    void    writeIndex();
+
+    Params                  p_;
+    std::FILE*              file_ = nullptr;
+
+    // — только поток писателя —
+    std::vector<SessionIndexEntry>  index_;
+    std::unique_ptr<std::uint8_t[]> buf_;                // текущий чанк
+    std::size_t                     buf_cap_  = 0;
+    std::size_t                     buf_used_ = 0;
+    std::uint32_t                   chunk_records_ = 0, chunk_frames_ = 0;
+    double                          chunk_t0_ = 0.0, chunk_t1_ = 0.0;
+    std::uint64_t                   offset_   = 0;       // позиция в файле
+    util::LzCodec                   lz_;
+    unsigned                        lz_skip_ = 0, lz_backoff_ = 1;
+    std::vector<std::uint8_t>       scratch_;            // сериализация детекций
+    bool                            io_error_ = false;
+
+    // — общее с циклом кадров —
+    mutable std::mutex      m_;
+    std::condition_variable cv_;
+    std::deque<Item>        queue_;
+    std::vector<cv::Mat>    pool_;                       // возвращённые буферы кадров
+    std::size_t             queued_frames_ = 0;
+    std::uint64_t           dropped_id_    = ~std::uint64_t{0};
+    double                  last_ts_       = 0.0;
+    bool                    stop_ = false;
+    Stats                   stats_;
+
+    std::thread             worker_;
+};
+
+//-------------------------------------------------------------
+// Чтение / воспроизведение
+//-------------------------------------------------------------
+class SessionReader {
+public:
+    /// @throws std::runtime_error, если файл не найден или не лог сессии
+    explicit SessionReader(const std::string& path);
+
+    /**
+     * @brief  Следующий кадр со всеми его записями; false — конец лога.
+     *         Буферы out.bgr / out.depth переиспользуются между вызовами.
+     */
+    bool next(SessionFrame& out);
+
+    /// Перейти к первому кадру с меткой >= ts (индекс → один чанк).
+    void seek(double ts);
+
+    std::size_t numFrames() const { return num_frames_; }
+    std::size_t numChunks() const { return index_.size(); }
+    double      beginTs()   const { return index_.empty() ? 0.0 : index_.front().t_first; }
+    double      endTs()     const { return index_.empty() ? 0.0 : index_.back().t_last; }
+    bool        recovered() const { return recovered_; }   ///< индекс восстановлен сканом
+
+private:
+    struct RecordView;
+
+    bool loadChunk(std::size_t i);
+    bool peek(RecordView& r);
+    void decodeImage(const RecordView& r, cv::Mat& dst) const;
+    void rebuildIndex(std::uint64_t file_size);
+
+    std::ifstream                 in_;
+    std::vector<SessionIndexEntry> index_;
+    std::vector<std::uint8_t>     chunk_;
+    std::size_t                   chunk_i_ = 0;         // следующий к загрузке
+    std::size_t                   pos_     = 0;         // смещение в chunk_
+    std::size_t                   num_frames_ = 0;
+    bool                          recovered_  = false;
+};
+
+} // namespace qrslam
@@ -0,0 +1,199 @@
+/**
+ * @file   TaskPool.cpp
+ */
+#include "TaskPool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/Affinity.hpp"
+
+namespace qrslam {
+
+namespace {
+
+// рабочий поток знает свой пул и индекс: submit() изнутри задачи
+// кладёт в собственную очередь, а не по кругу
+thread_local const TaskPool* tls_pool  = nullptr;
+thread_local int             tls_index = -1;
+
+} // namespace
+
+// ---------------------------------------------------------------------
+// ctor / dtor
+// ---------------------------------------------------------------------
+TaskPool::TaskPool(const Params& p) {
+    const int n = std::max(1, p.threads);
+    workers_.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) workers_.push_back(std::make_unique<Worker>());
+
+    // ядер хватает — по одному на поток (кэш не делится), иначе весь набор
+    const bool one_each = p.cpus.size() >= static_cast<std::size_t>(n);
+    for (int i = 0; i < n; ++i) {
+        std::vector<int> cpus = one_each ? std::vector<int>{p.cpus[static_cast<std::size_t>(i)]}
+                                         : p.cpus;
+        workers_[static_cast<std::size_t>(i)]->th =
+            std::thread(&TaskPool::loop, this, i, std::move(cpus));
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lk(sleep_m_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& w : workers_)
+        if (w->th.joinable()) w->th.join();
+}
+
+// ---------------------------------------------------------------------
+// Group
+// ---------------------------------------------------------------------
+void TaskPool::Group::run(std::function<void()> fn) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.push({std::move(fn), this});
+}
+
+void TaskPool::Group::wait() {
+    // рабочий поток помогает только своей группе; поток вне пула спит
+    if (tls_pool == &pool_)
+        while (pending_.load(std::memory_order_acquire) > 0 && pool_.runOneOf(this)) {}
+
+    // остаток уже выполняется рабочими; замок гарантирует, что done()
+    // вышел из критической секции до разрушения группы
+    std::unique_lock<std::mutex> lk(m_);
+    cv_.wait(lk, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+void TaskPool::Group::done() {
+    std::lock_guard<std::mutex> lk(m_);
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) cv_.notify_all();
+}
+
+// ---------------------------------------------------------------------
+// очереди
+// ---------------------------------------------------------------------
+void TaskPool::push(Task t) {
+    const std::size_t n = workers_.size();
+    const std::size_t i = tls_pool == this
+        ? static_cast<std::size_t>(tls_index)
+        : rr_.fetch_add(1, std::memory_order_relaxed) % n;
+    // счётчик — до вставки: иначе вор может уменьшить его раньше
+    const std::size_t q = queued_.fetch_add(1, std::memory_order_release) + 1;
+    {
+        std::lock_guard<std::mutex> lk(workers_[i]->m);
+        workers_[i]->q.push_back(std::move(t));
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t hwm = queue_hwm_.load(std::memory_order_relaxed);
+    while (q > hwm && !queue_hwm_.compare_exchange_weak(hwm, q, std::memory_order_relaxed)) {}
+
+    // пустая критическая секция: спящий поток не пропустит пробуждение
+    { std::lock_guard<std::mutex> lk(sleep_m_); }
+    sleep_cv_.notify_one();
+}
+
+bool TaskPool::popLocal(int self, Task& t) {
+    Worker& w = *workers_[static_cast<std::size_t>(self)];
+    std::lock_guard<std::mutex> lk(w.m);
+    if (w.q.empty()) return false;
+    t = std::move(w.q.back());
+    w.q.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(int self, Task& t) {
+    const std::size_t n     = workers_.size();
+    const std::size_t start = static_cast<std::size_t>(self) + 1;
+    for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t v = (start + k) % n;
+        if (static_cast<int>(v) == self) continue;
+        Worker& w = *workers_[v];
+        std::lock_guard<std::mutex> lk(w.m);
+        if (w.q.empty()) continue;
+        t = std::move(w.q.front());                // старейшая задача жертвы
+        w.q.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool TaskPool::runOne(int self) {
+    if (queued_.load(std::memory_order_acquire) == 0) return false;
+    Task t;
+    if (popLocal(self, t)) {
+        // своя очередь
+    } else if (steal(self, t)) {
+        stolen_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    execute(t);
+    return true;
+}
+
+bool TaskPool::runOneOf(const Group* g) {
+    if (queued_.load(std::memory_order_acquire) == 0) return false;
+    Task t;
+    bool found = false;
+    for (auto& w : workers_) {
+        std::lock_guard<std::mutex> lk(w->m);
+        const auto it = std::find_if(w->q.begin(), w->q.end(),
+                                     [g](const Task& x) { return x.group == g; });
+        if (it == w->q.end()) continue;
+        t = std::move(*it);
+        w->q.erase(it);
+        found = true;
+        break;
+    }
+    if (!found) return false;
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    helped_.fetch_add(1, std::memory_order_relaxed);
+    execute(t);
+    return true;
+}
+
+void TaskPool::execute(Task& t) {
+    try {
+        t.fn();
+    } catch (const std::exception& ex) {
+        spdlog::error("[TaskPool] task failed: {}", ex.what());
+    } catch (...) {
+        spdlog::error("[TaskPool] task failed: unknown exception");
+    }
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    if (t.group) t.group->done();
+}
+
+void TaskPool::loop(int idx, std::vector<int> cpus) {
+    tls_pool  = this;
+    tls_index = idx;
+    if (!util::pinCurrentThread(cpus))
+        spdlog::warn("[TaskPool] worker {}: cannot set CPU affinity", idx);
+
+    while (true) {
+        if (runOne(idx)) continue;
+        std::unique_lock<std::mutex> lk(sleep_m_);
+        sleep_cv_.wait(lk, [this] {
+            return stop_ || queued_.load(std::memory_order_acquire) > 0;
+        });
+        if (stop_ && queued_.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+TaskPool::Stats TaskPool::stats() const {
+    Stats s;
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.executed  = executed_.load(std::memory_order_relaxed);
+    s.stolen    = stolen_.load(std::memory_order_relaxed);
+    s.helped    = helped_.load(std::memory_order_relaxed);
+    s.queued    = queued_.load(std::memory_order_relaxed);
+    s.queue_hwm = queue_hwm_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace qrslam
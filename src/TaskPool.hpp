@@ -0,0 +1,115 @@
+#pragma once
+/**
+ * @file   TaskPool.hpp
+ * @brief  Пул задач с work stealing для всей не-SLAM работы приложения.
+ *
+ *  У каждого рабочего потока своя очередь: владелец берёт задачи с конца
+ *  (LIFO — данные ещё в кэше), простаивающий поток крадёт с начала чужой
+ *  очереди. Задачи извне пула раздаются по очередям по кругу.
+ *
+ *  Рабочие потоки закрепляются за ядрами Params::cpus (по одному ядру на
+ *  поток, если ядер хватает), чтобы не конкурировать с потоками SLAM.
+ *
+ *  Group — ожидание набора задач. Поток вне пула (цикл кадров на ядрах
+ *  SLAM) просто спит: работа пула не должна попадать на ядра SLAM, а чужая
+ *  задача (фоновый шаг MapHousekeeper) — растягивать его кадр. Рабочий
+ *  поток пула при вложенном ожидании выполняет задачи только своей группы,
+ *  чтобы пул не встал, когда все потоки ждут.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qrslam {
+
+class TaskPool {
+public:
+    struct Params {
+        int              threads = 2;   ///< рабочих потоков (≥ 1)
+        std::vector<int> cpus;          ///< ядра для рабочих потоков; пусто = без привязки
+    };
+
+    struct Stats {
+        std::uint64_t submitted = 0;   ///< поставлено задач
+        std::uint64_t executed  = 0;   ///< выполнено (включая помощь из Group::wait)
+        std::uint64_t stolen    = 0;   ///< украдено рабочими из чужих очередей
+        std::uint64_t helped    = 0;   ///< выполнено рабочими внутри Group::wait
+        std::size_t   queued    = 0;   ///< в очередях сейчас
+        std::size_t   queue_hwm = 0;   ///< максимум queued
+    };
+
+    class Group {
+    public:
+        explicit Group(TaskPool& pool) : pool_{pool} {}
+        ~Group() { wait(); }
+
+        Group(const Group&)            = delete;
+        Group& operator=(const Group&) = delete;
+
+        void run(std::function<void()> fn);
+
+        /// Дождаться всех задач группы (рабочий поток пула — помогая ей).
+        void wait();
+
+    private:
+        friend class TaskPool;
+        void done();
+
+        TaskPool&               pool_;
+        std::atomic<int>        pending_{0};
+        std::mutex              m_;
+        std::condition_variable cv_;
+    };
+
+    explicit TaskPool(const Params& p);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&)            = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /// Поставить задачу без ожидания результата.
+    void submit(std::function<void()> fn) { push({std::move(fn), nullptr}); }
+
+    int   size() const { return static_cast<int>(workers_.size()); }
+    Stats stats() const;
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        Group*                group;
+    };
+    struct Worker {
+        std::mutex       m;
+        std::deque<Task> q;
+        std::thread      th;
+    };
+
+    void push(Task t);
+    bool runOne(int self);
+    bool runOneOf(const Group* g);      // задача только этой группы
+    bool popLocal(int self, Task& t);
+    bool steal(int self, Task& t);
+    void execute(Task& t);
+    void loop(int idx, std::vector<int> cpus);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex                 sleep_m_;
+    std::condition_variable    sleep_cv_;
+    bool                       stop_ = false;
+
+    std::atomic<std::size_t>   queued_{0};
+    std::atomic<std::size_t>   queue_hwm_{0};
+    std::atomic<std::uint64_t> submitted_{0}, executed_{0}, stolen_{0}, helped_{0};
+    std::atomic<unsigned>      rr_{0};
+};
+
+} // namespace qrslam
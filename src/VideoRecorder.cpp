@@ -0,0 +1,120 @@
+/**
+ * @file   VideoRecorder.cpp
+ */
+#include "VideoRecorder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace qrslam {
+
+// ---------------------------------------------------------------------
+// ctor / dtor
+// ---------------------------------------------------------------------
+VideoRecorder::VideoRecorder(Params p) : p_{std::move(p)} {
+    if (p_.fourcc.size() != 4)
+        throw std::invalid_argument("VideoRecorder: fourcc must have 4 chars");
+    if (p_.queue == 0) p_.queue = 1;
+    worker_ = std::thread(&VideoRecorder::encodeLoop, this);
+}
+
+VideoRecorder::~VideoRecorder() { stop(); }
+
+// ---------------------------------------------------------------------
+// public
+// ---------------------------------------------------------------------
+bool VideoRecorder::push(const cv::Mat& frame_bgr) {
+    if (frame_bgr.empty()) return false;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_) return false;
+        ++stats_.pushed;
+
+        const std::size_t n = queue_.size();
+        switch (p_.policy) {
+            case DropPolicy::DropOldest:
+                if (n >= p_.queue) { queue_.pop_front(); ++stats_.dropped; }
+                break;
+            case DropPolicy::DropNewest:
+                if (n >= p_.queue) { ++stats_.dropped; return false; }
+                break;
+            case DropPolicy::Decimate:
+                if (n >= p_.queue) { ++stats_.dropped; return false; }
+                if (n >= p_.queue / 2 && (decim_counter_++ % std::max(1, p_.decimate)) != 0) {
+                    ++stats_.dropped;
+                    return false;
+                }
+                if (n < p_.queue / 2) decim_counter_ = 0;
+                break;
+        }
+        queue_.push_back(frame_bgr);          // только заголовок + refcount
+        stats_.queue_hwm = std::max(stats_.queue_hwm, queue_.size());
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void VideoRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stop_ && !worker_.joinable()) return;
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+VideoRecorder::Stats VideoRecorder::stats() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return stats_;
+}
+
+VideoRecorder::DropPolicy VideoRecorder::parsePolicy(const std::string& s) {
+    if (s == "drop_oldest") return DropPolicy::DropOldest;
+    if (s == "drop_newest") return DropPolicy::DropNewest;
+    if (s == "decimate")    return DropPolicy::Decimate;
+    throw std::invalid_argument("unknown record.policy '" + s +
+                                "' (drop_oldest | drop_newest | decimate)");
+}
+
+// ---------------------------------------------------------------------
+// поток кодировщика
+// ---------------------------------------------------------------------
+void VideoRecorder::encodeLoop() {
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) break;                 // stop_ и всё дописано
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        // файл открываем по первому кадру — тогда известен размер
+        if (!writer_.isOpened()) {
+            const auto& f = p_.fourcc;
+            writer_.open(p_.path, cv::VideoWriter::fourcc(f[0], f[1], f[2], f[3]),
+                         p_.fps, frame.size(), frame.channels() == 3);
+            if (!writer_.isOpened()) {
+                spdlog::error("[VideoRecorder] cannot open {}", p_.path);
+                std::lock_guard<std::mutex> lk(m_);
+                stats_.dropped += 1 + queue_.size();
+                queue_.clear();
+                stop_ = true;                          // дальнейшие push() отклоняются
+                break;
+            }
+            spdlog::info("[VideoRecorder] recording {} ({}x{} @ {} fps)",
+                         p_.path, frame.cols, frame.rows, p_.fps);
+        }
+
+        writer_.write(frame);
+        std::lock_guard<std::mutex> lk(m_);
+        ++stats_.written;
+    }
+    writer_.release();
+}
+
+} // namespace qrslam
@@ -0,0 +1,86 @@
+#pragma once
+/**
+ * @file   VideoRecorder.hpp
+ * @brief  Асинхронная запись аннотированного видео (overlay) в файл.
+ *
+ *  push() никогда не блокирует цикл кадров: кадр кладётся в ограниченную
+ *  очередь по ссылке (cv::Mat с подсчётом ссылок, без копии пикселей),
+ *  кодирование идёт в отдельном потоке. Если кодировщик не успевает,
+ *  кадры отбрасываются по политике DropPolicy и учитываются в stats().
+ *
+ *  Вызывающий код не должен писать в буфер кадра после push():
+ *  перед следующим захватом достаточно отпустить свой cv::Mat.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace qrslam {
+
+class VideoRecorder {
+public:
+    enum class DropPolicy {
+        DropOldest,   ///< очередь полна → выкинуть самый старый кадр
+        DropNewest,   ///< очередь полна → не брать новый кадр
+        Decimate,     ///< очередь заполнена наполовину → брать каждый N-й
+    };
+
+    struct Params {
+        std::string path;                 ///< пусто = запись выключена
+        std::string fourcc   = "MJPG";
+        double      fps      = 30.0;
+        std::size_t queue    = 8;         ///< макс. кадров в очереди
+        DropPolicy  policy   = DropPolicy::DropOldest;
+        int         decimate = 2;         ///< N для DropPolicy::Decimate
+    };
+
+    struct Stats {
+        std::uint64_t pushed  = 0;   ///< предложено кадров
+        std::uint64_t written = 0;   ///< закодировано
+        std::uint64_t dropped = 0;   ///< отброшено политикой
+        std::size_t   queue_hwm = 0; ///< максимум очереди
+    };
+
+    explicit VideoRecorder(Params p);
+    ~VideoRecorder();
+
+    VideoRecorder(const VideoRecorder&)            = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    /// Неблокирующая постановка кадра (BGR 8UC3). false — кадр отброшен.
+    bool push(const cv::Mat& frame_bgr);
+
+    /// Дописать очередь и закрыть файл (вызывается и из деструктора).
+    void stop();
+
+    Stats stats() const;
+
+    /// "drop_oldest" | "drop_newest" | "decimate"
+    static DropPolicy parsePolicy(const std::string& s);
+
+private:
+    void encodeLoop();
+
+    Params                  p_;
+    cv::VideoWriter         writer_;       // только поток кодировщика
+
+    mutable std::mutex      m_;
+    std::condition_variable cv_;
+    std::deque<cv::Mat>     queue_;
+    bool                    stop_ = false;
+    Stats                   stats_;
+    std::uint64_t           decim_counter_ = 0;
+
+    std::thread             worker_;
+};
+
+} // namespace qrslam
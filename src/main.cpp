@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <exception>
+#include <string>
 
 #include "App.hpp"  // здесь скрыта вся логика инициализации SLAM + QR-tracker
 
@@ -41,15 +42,30 @@ int main(int argc, char** argv) {
     }
 
     try {
-        // Класс App.hpp внутри себя сам парсит те же самые флаги:
-        //   --config, --camera, --vocab, --cam
-        //
-        // В конструкторе App происходит вся загрузка YAML-ов,
-        // инициализация SLAM, MarkerTracker, QRScanner и т.п.
-        qrslam::App application(argc, argv);
+        std::string app_yaml, camera_yaml, vocab;
+        int cam_id = -1;
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const std::string flag = argv[i];
+            if      (flag == "--config") app_yaml    = argv[i + 1];
+            else if (flag == "--camera") camera_yaml = argv[i + 1];
+            else if (flag == "--vocab")  vocab       = argv[i + 1];
+            else if (flag == "--cam")    cam_id      = std::stoi(argv[i + 1]);
+            else { printUsage(argv[0]); return EXIT_FAILURE; }
+        }
+
+        // app.yaml → AppParams; пути SLAM и камера — из командной строки
+        qrslam::AppParams params = qrslam::loadAppParams(app_yaml);
+        params.config_path = camera_yaml;
+        params.vocab_path  = vocab;
+        if (cam_id >= 0) params.cam_id = cam_id;
+
+        // В конструкторе App происходит инициализация SLAM,
+        // MarkerTracker, QR-детектора и т.п.
+        qrslam::App application(params);
 
         // Запускаем основной цикл
-        return application.run();
+        application.run();
+        return EXIT_SUCCESS;
     }
     catch (const std::exception& ex) {
         std::cerr << "Fatal error: " << ex.what() << "\n";
@@ -0,0 +1,238 @@
+/**
+ * @file   autotune.cpp
+ * @brief  Офлайн-подбор ORB/QR-настроек: сетка по параметрам, прогон
+ *         записанной сессии через конвейер и фронт Парето
+ *         (CPU на кадр ↔ доля потерь трекинга ↔ ошибка позы маркеров).
+ *
+ *  Пример:
+ *    ./autotune --session logs/session.qrs --camera config/camera.yaml \
+ *               --vocab config/orb_vocab.fbow \
+ *               --keypoints 500,1000,2000 --levels 4,8 --scale 1.2,1.3 \
+ *               --qr-interval 1,2,4 --out pareto.csv --all runs.csv
+ *
+ *  По умолчанию кадры подаются в темпе записи (--fast — без пауз):
+ *  локальный маппинг получает столько же времени, сколько в поле.
+ *
+ *  --map <site.msg> [--markers <site_markers.yml>] добавляет в сетку режим
+ *  локализации по готовой карте: каждая точка прогоняется и полным SLAM,
+ *  и без mapping — колонка mode в CSV. Режимы не сравнимы по CPU (без
+ *  mapping дешевле всегда), поэтому фронт Парето строится для каждого
+ *  режима отдельно, а в консоль вдобавок выводятся оба режима рядом для
+ *  каждой точки сетки.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ReplayRunner.hpp"
+
+namespace {
+
+using qrslam::ReplayRunner;
+
+struct Run {
+    ReplayRunner::Settings s;
+    ReplayRunner::Metrics  m;
+    bool                   pareto = false;
+};
+
+template <class T>
+std::vector<T> splitCsv(const std::string& str) {
+    std::vector<T> out;
+    std::stringstream ss(str);
+    for (std::string tok; std::getline(ss, tok, ',');) {
+        if (tok.empty()) continue;
+        std::istringstream v(tok);
+        T x{};
+        if (v >> x) out.push_back(x);
+    }
+    return out;
+}
+
+/// NaN (маркеров не было) — хуже любого числа, но равен другому NaN
+double key(double v) { return std::isnan(v) ? std::numeric_limits<double>::infinity() : v; }
+
+/// a не хуже b по всем целям и строго лучше хотя бы по одной
+bool dominates(const ReplayRunner::Metrics& a, const ReplayRunner::Metrics& b) {
+    const double ka[] = {a.cpu_ms, a.lost_ratio, key(a.marker_err_px)};
+    const double kb[] = {b.cpu_ms, b.lost_ratio, key(b.marker_err_px)};
+    bool better = false;
+    for (int i = 0; i < 3; ++i) {
+        if (ka[i] > kb[i]) return false;
+        if (ka[i] < kb[i]) better = true;
+    }
+    return better;
+}
+
+/// фронт — внутри режима (slam / localization), не общий
+void markPareto(std::vector<Run>& runs) {
+    for (auto& r : runs) {
+        r.pareto = std::none_of(runs.begin(), runs.end(), [&](const Run& o) {
+            return o.s.localization == r.s.localization && dominates(o.m, r.m);
+        });
+    }
+}
+
+const char* modeName(const Run& r) { return r.s.localization ? "localization" : "slam"; }
+
+void printFront(const std::vector<Run>& runs, bool localization) {
+    std::cout << "\nPareto front, " << (localization ? "localization" : "slam")
+              << " (cpu ↔ lost ↔ marker error):\n"
+              << std::right << std::setw(8) << "kp" << std::setw(8) << "levels"
+              << std::setw(8) << "scale" << std::setw(6) << "qr"
+              << std::setw(10) << "cpu ms" << std::setw(10) << "p95 ms"
+              << std::setw(9) << "lost %" << std::setw(10) << "err px" << "\n";
+    for (const auto& r : runs) {
+        if (!r.pareto || r.s.localization != localization) continue;
+        std::cout << std::fixed
+                  << std::setw(8)  << r.s.max_num_keypoints
+                  << std::setw(8)  << r.s.num_levels
+                  << std::setw(8)  << std::setprecision(2) << r.s.scale_factor
+                  << std::setw(6)  << r.s.qr_interval
+                  << std::setw(10) << std::setprecision(2) << r.m.cpu_ms
+                  << std::setw(10) << r.m.track_ms_p95
+                  << std::setw(9)  << std::setprecision(1) << r.m.lost_ratio * 100
+                  << std::setw(10) << std::setprecision(2) << r.m.marker_err_px << "\n";
+    }
+}
+
+/// slam и localization рядом для каждой точки сетки (* — на фронте режима);
+/// runs — в порядке прогона: пары slam, localization подряд
+void printSideBySide(const std::vector<Run>& runs) {
+    std::cout << "\nSLAM vs localization per grid point (* = on the mode's front):\n"
+              << std::right << std::setw(8) << "kp" << std::setw(8) << "levels"
+              << std::setw(8) << "scale" << std::setw(6) << "qr"
+              << std::setw(22) << "slam cpu/lost%/err"
+              << std::setw(22) << "loc cpu/lost%/err" << "\n";
+    const auto cell = [](const Run& r) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2) << r.m.cpu_ms << '/'
+           << std::setprecision(1) << r.m.lost_ratio * 100 << '/'
+           << std::setprecision(2) << r.m.marker_err_px << (r.pareto ? "*" : " ");
+        return os.str();
+    };
+    for (std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+        const Run& a = runs[i];
+        const Run& b = runs[i + 1];
+        std::cout << std::fixed
+                  << std::setw(8) << a.s.max_num_keypoints
+                  << std::setw(8) << a.s.num_levels
+                  << std::setw(8) << std::setprecision(2) << a.s.scale_factor
+                  << std::setw(6) << a.s.qr_interval
+                  << std::setw(22) << cell(a) << std::setw(22) << cell(b) << "\n";
+    }
+}
+
+void writeCsv(const std::string& path, const std::vector<Run>& runs, bool pareto_only) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[autotune] cannot write " << path << "\n";
+        return;
+    }
+    out << "mode,max_num_keypoints,num_levels,scale_factor,qr_interval,frames,"
+           "cpu_ms,track_ms_mean,track_ms_p95,lost_ratio,marker_err_px,marker_obs,pareto\n";
+    for (const auto& r : runs) {
+        if (pareto_only && !r.pareto) continue;
+        out << modeName(r) << ','
+            << r.s.max_num_keypoints << ',' << r.s.num_levels << ',' << r.s.scale_factor << ','
+            << r.s.qr_interval << ',' << r.m.frames << ',' << r.m.cpu_ms << ','
+            << r.m.track_ms_mean << ',' << r.m.track_ms_p95 << ',' << r.m.lost_ratio << ',';
+        if (!std::isnan(r.m.marker_err_px)) out << r.m.marker_err_px;
+        out << ',' << r.m.marker_obs << ',' << (r.pareto ? 1 : 0) << '\n';
+    }
+    std::cout << "[autotune] written " << path << "\n";
+}
+
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --session <log.qrs> --camera <camera.yaml>"
+              << " --vocab <orb_vocab.fbow>\n"
+              << "       [--keypoints a,b] [--levels a,b] [--scale a,b] [--qr-interval a,b]\n"
+              << "       [--detector opencv] [--marker-size 0.04] [--from T] [--to T]\n"
+              << "       [--fast 1] [--out pareto.csv] [--all runs.csv]\n"
+              << "       [--map site.msg [--markers site_markers.yml]]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayRunner::Params p;
+    std::vector<int>    keypoints{500, 1000, 2000};
+    std::vector<int>    levels{4, 8};
+    std::vector<double> scales{1.2};
+    std::vector<int>    intervals{1, 2, 4};
+    std::string         out_path = "autotune_pareto.csv", all_path;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        const std::string val  = argv[i + 1];
+        if      (flag == "--session")     p.session_path = val;
+        else if (flag == "--camera")      p.camera_yaml  = val;
+        else if (flag == "--vocab")       p.vocab_path   = val;
+        else if (flag == "--detector")    p.qr_detector  = val;
+        else if (flag == "--marker-size") p.marker_size  = std::stod(val);
+        else if (flag == "--from")        p.t_begin      = std::stod(val);
+        else if (flag == "--to")          p.t_end        = std::stod(val);
+        else if (flag == "--fast")        p.realtime     = val == "0";
+        else if (flag == "--keypoints")   keypoints      = splitCsv<int>(val);
+        else if (flag == "--levels")      levels         = splitCsv<int>(val);
+        else if (flag == "--scale")       scales         = splitCsv<double>(val);
+        else if (flag == "--qr-interval") intervals      = splitCsv<int>(val);
+        else if (flag == "--out")         out_path       = val;
+        else if (flag == "--all")         all_path       = val;
+        else if (flag == "--map")         p.map_path     = val;
+        else if (flag == "--markers")     p.marker_db    = val;
+        else { printUsage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (p.session_path.empty() || p.camera_yaml.empty() || p.vocab_path.empty() ||
+        keypoints.empty() || levels.empty() || scales.empty() || intervals.empty()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const ReplayRunner runner(p);
+
+        std::vector<bool> modes{false};
+        if (!p.map_path.empty()) modes.push_back(true);
+
+        std::vector<Run> runs;
+        const std::size_t total = keypoints.size() * levels.size() * scales.size() *
+                                  intervals.size() * modes.size();
+        for (int kp : keypoints)
+            for (int lv : levels)
+                for (double sf : scales)
+                    for (int qi : intervals)
+                        for (bool loc : modes) {
+                            Run r;
+                            r.s = ReplayRunner::Settings{kp, lv, sf, qi, loc};
+                            std::cout << "[autotune] run " << runs.size() + 1 << "/" << total
+                                      << (loc ? "  localization" : "  slam")
+                                      << "  kp=" << kp << " levels=" << lv << " scale=" << sf
+                                      << " qr=" << qi << std::endl;
+                            r.m = runner.run(r.s);
+                            runs.push_back(r);
+                        }
+
+        markPareto(runs);
+        if (modes.size() > 1) printSideBySide(runs);   // до сортировки: пары подряд
+        std::sort(runs.begin(), runs.end(),
+                  [](const Run& a, const Run& b) { return a.m.cpu_ms < b.m.cpu_ms; });
+        for (bool loc : modes) printFront(runs, loc);
+
+        writeCsv(out_path, runs, true);
+        if (!all_path.empty()) writeCsv(all_path, runs, false);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "[autotune] " << ex.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
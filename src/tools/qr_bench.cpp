@@ -0,0 +1,172 @@
+/**
+ * @file   qr_bench.cpp
+ * @brief  Бенчмарк бэкендов QrDetector: пропускная способность и
+ *         доля кадров с успешной детекцией.
+ *
+ *  Пример:
+ *    ./qr_bench --input rec/scan.mp4 --expect 1
+ *    ./qr_bench --input "frames/*.png" --detectors opencv,finder --repeat 3
+ *
+ *  Все кадры предварительно загружаются в память (серые), чтобы
+ *  декодирование видео не попадало в замер.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "QrDetector.hpp"
+#include "utils/Timer.hpp"
+
+namespace {
+
+struct Result {
+    std::string name;
+    double      fps       = 0.0;   ///< кадров/с
+    double      ms        = 0.0;   ///< среднее время детекции, мс
+    double      rate      = 0.0;   ///< доля кадров с >= expect кодами
+    double      avg_codes = 0.0;
+};
+
+std::vector<cv::Mat> loadFrames(const std::string& input, int max_frames) {
+    std::vector<cv::Mat> frames;
+    auto push = [&](const cv::Mat& img) {
+        if (img.empty()) return;
+        cv::Mat gray;
+        if (img.channels() == 1) gray = img;
+        else cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+        frames.push_back(gray);
+    };
+
+    if (input.find('*') != std::string::npos) {         // шаблон файлов
+        std::vector<cv::String> files;
+        cv::glob(input, files, false);
+        std::sort(files.begin(), files.end());
+        for (const auto& f : files) {
+            if (static_cast<int>(frames.size()) >= max_frames) break;
+            push(cv::imread(f, cv::IMREAD_GRAYSCALE));
+        }
+        return frames;
+    }
+
+    cv::VideoCapture cap(input);                         // видеофайл
+    cv::Mat img;
+    while (static_cast<int>(frames.size()) < max_frames && cap.read(img))
+        push(img);
+    return frames;
+}
+
+std::vector<std::string> splitCsv(const std::string& s) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    for (std::string tok; std::getline(ss, tok, ',');)
+        if (!tok.empty()) out.push_back(tok);
+    return out;
+}
+
+void printUsage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --input <video|\"dir/*.png\">"
+              << " [--expect N] [--repeat R] [--max-frames M]"
+              << " [--detectors a,b,c]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string input;
+    int expect = 1, repeat = 1, max_frames = 1000;
+    std::vector<std::string> names = qrslam::availableQrDetectors();
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        if      (flag == "--input")      input      = argv[i + 1];
+        else if (flag == "--expect")     expect     = std::stoi(argv[i + 1]);
+        else if (flag == "--repeat")     repeat     = std::max(1, std::stoi(argv[i + 1]));
+        else if (flag == "--max-frames") max_frames = std::stoi(argv[i + 1]);
+        else if (flag == "--detectors")  names      = splitCsv(argv[i + 1]);
+        else { printUsage(argv[0]); return EXIT_FAILURE; }
+    }
+    if (input.empty()) { printUsage(argv[0]); return EXIT_FAILURE; }
+
+    const auto frames = loadFrames(input, max_frames);
+    if (frames.empty()) {
+        std::cerr << "[bench] no frames in " << input << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "[bench] " << frames.size() << " frames "
+              << frames[0].cols << "x" << frames[0].rows
+              << ", repeat " << repeat << "\n";
+
+    std::vector<Result> results;
+    std::vector<qrslam::QrDetection> dets;
+    for (const auto& name : names) {
+        auto det = qrslam::makeQrDetector(name);
+        det->detect(frames[0], dets);                    // прогрев
+
+        Result r;
+        r.name = name;
+        std::size_t hits = 0, codes = 0;
+        qrslam::util::StopWatch sw;
+        for (int rep = 0; rep < repeat; ++rep) {
+            for (const auto& f : frames) {
+                det->detect(f, dets);
+                if (rep == 0) {
+                    codes += dets.size();
+                    if (static_cast<int>(dets.size()) >= expect) ++hits;
+                }
+            }
+        }
+        const double total = sw.elapsed();
+        const double n     = static_cast<double>(frames.size()) * repeat;
+        r.fps       = n / total;
+        r.ms        = total * 1e3 / n;
+        r.rate      = static_cast<double>(hits)  / frames.size();
+        r.avg_codes = static_cast<double>(codes) / frames.size();
+        results.push_back(r);
+    }
+
+    // ранги по каждой метрике; итог — сортировка по скорости
+    auto rankOf = [&](auto key) {
+        std::vector<std::size_t> idx(results.size()), rank(results.size());
+        for (std::size_t i = 0; i < idx.size(); ++i) idx[i] = i;
+        std::stable_sort(idx.begin(), idx.end(),
+                         [&](std::size_t a, std::size_t b) { return key(results[a]) > key(results[b]); });
+        for (std::size_t r = 0; r < idx.size(); ++r) rank[idx[r]] = r + 1;
+        return rank;
+    };
+    const auto rank_fps  = rankOf([](const Result& r) { return r.fps; });
+    const auto rank_rate = rankOf([](const Result& r) { return r.rate; });
+
+    std::vector<std::size_t> order(results.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&](std::size_t a, std::size_t b) { return rank_fps[a] < rank_fps[b]; });
+
+    std::cout << "\n" << std::left << std::setw(10) << "detector"
+              << std::right << std::setw(10) << "fps"
+              << std::setw(10) << "ms/frame"
+              << std::setw(10) << "det.rate"
+              << std::setw(10) << "codes"
+              << std::setw(8)  << "#speed"
+              << std::setw(8)  << "#rate" << "\n";
+    for (std::size_t i : order) {
+        const Result& r = results[i];
+        std::cout << std::left  << std::setw(10) << r.name
+                  << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(1) << r.fps
+                  << std::setw(10) << std::setprecision(2) << r.ms
+                  << std::setw(9)  << std::setprecision(1) << r.rate * 100 << "%"
+                  << std::setw(10) << std::setprecision(2) << r.avg_codes
+                  << std::setw(8)  << rank_fps[i]
+                  << std::setw(8)  << rank_rate[i] << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+#pragma once
+/**
+ * @file   Affinity.hpp
+ * @brief  Привязка потоков к ядрам (Linux, pthread_setaffinity_np).
+ *
+ *  Новый поток наследует маску создателя, поэтому чужие потоки
+ *  (mapping / loop closing SLAM, кодировщик записи) закрепляются так:
+ *  сузить маску текущего потока → создать их → вернуть маску.
+ *
+ *  На других ОС функции ничего не делают и возвращают false.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <vector>
+
+#ifdef __linux__
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+namespace qrslam::util {
+
+/// Ядра, на которых сейчас разрешено выполняться вызывающему потоку.
+inline std::vector<int> currentAffinity() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+#endif
+    return cpus;
+}
+
+/// Закрепить вызывающий поток за ядрами @p cpus. Пустой список — no-op.
+inline bool pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return true;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus)
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    if (CPU_COUNT(&set) == 0) return false;
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/// Маска потока на время области видимости; в деструкторе — прежняя.
+class ScopedAffinity {
+public:
+    explicit ScopedAffinity(const std::vector<int>& cpus)
+        : saved_{cpus.empty() ? std::vector<int>{} : currentAffinity()} {
+        pinCurrentThread(cpus);
+    }
+    ~ScopedAffinity() { pinCurrentThread(saved_); }
+
+    ScopedAffinity(const ScopedAffinity&)            = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+private:
+    std::vector<int> saved_;
+};
+
+} // namespace qrslam::util
@@ -0,0 +1,65 @@
+/**
+ * @file   AllocCounter.cpp
+ * @brief  Подмена глобальных operator new/delete со счётчиками.
+ *
+ *  Собирается только с опцией QRSLAM_COUNT_ALLOCS (см. корневой CMake).
+ */
+#include "AllocCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local std::uint64_t t_count = 0;
+thread_local std::uint64_t t_bytes = 0;
+
+void* countedAlloc(std::size_t n) {
+    ++t_count;
+    t_bytes += n;
+    if (n == 0) n = 1;
+    if (void* p = std::malloc(n)) return p;
+    throw std::bad_alloc{};
+}
+
+void* countedAlignedAlloc(std::size_t n, std::align_val_t al) {
+    ++t_count;
+    t_bytes += n;
+    const auto a = static_cast<std::size_t>(al);
+    const std::size_t sz = (n + a - 1) / a * a;      // aligned_alloc: size % align == 0
+    if (void* p = std::aligned_alloc(a, sz ? sz : a)) return p;
+    throw std::bad_alloc{};
+}
+
+} // namespace
+
+namespace qrslam::util {
+
+AllocStats threadAllocStats() noexcept { return {t_count, t_bytes}; }
+
+} // namespace qrslam::util
+
+// ---------------------------------------------------------------------
+// global replacements
+// ---------------------------------------------------------------------
+void* operator new(std::size_t n)   { return countedAlloc(n); }
+void* operator new[](std::size_t n) { return countedAlloc(n); }
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(n); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(n); } catch (...) { return nullptr; }
+}
+
+void* operator new(std::size_t n, std::align_val_t al)   { return countedAlignedAlloc(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return countedAlignedAlloc(n, al); }
+
+void operator delete(void* p) noexcept                          { std::free(p); }
+void operator delete[](void* p) noexcept                        { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept             { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept           { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept        { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept      { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept   { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
@@ -0,0 +1,96 @@
+#pragma once
+/**
+ * @file   AllocCounter.hpp
+ * @brief  Отладочный счётчик heap-аллокаций на кадр.
+ *
+ *  Глобальные operator new/delete подменяются в AllocCounter.cpp, который
+ *  собирается только при -DQRSLAM_COUNT_ALLOCS=ON. Без этого флага все
+ *  вызовы ниже — пустые inline-заглушки, а counted() == false.
+ *
+ *  Счётчики thread_local: FrameAllocProbe видит только аллокации
+ *  своего потока. Кадр же обрабатывается и главным потоком, и задачами
+ *  TaskPool на рабочих потоках, поэтому итог кадра складывается из двух
+ *  частей: FrameAllocProbe главного потока + FrameAllocTally, куда каждая
+ *  задача кадра отдаёт свою разницу через TaskAllocProbe (RAII на время
+ *  задачи). Потоки SLAM, записи и фоновые задачи вне кадра
+ *  (MapHousekeeper) в статистику кадра не попадают.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <atomic>
+#include <cstdint>
+
+namespace qrslam::util {
+
+struct AllocStats {
+    std::uint64_t count = 0;   ///< число вызовов operator new
+    std::uint64_t bytes = 0;   ///< суммарный запрошенный объём
+};
+
+#ifdef QRSLAM_COUNT_ALLOCS
+/// текущие счётчики вызывающего потока (определены в AllocCounter.cpp)
+AllocStats threadAllocStats() noexcept;
+constexpr bool allocCountingEnabled() { return true; }
+#else
+inline AllocStats threadAllocStats() noexcept { return {}; }
+constexpr bool allocCountingEnabled() { return false; }
+#endif
+
+//--------------------------------------------------------------
+// FrameAllocProbe — разница счётчиков между началом и концом кадра
+//--------------------------------------------------------------
+class FrameAllocProbe {
+public:
+    FrameAllocProbe() : start_{threadAllocStats()} {}
+
+    /// аллокации с момента создания / прошлого restart()
+    [[nodiscard]] inline AllocStats delta() const noexcept {
+        AllocStats now = threadAllocStats();
+        return {now.count - start_.count, now.bytes - start_.bytes};
+    }
+
+    inline void restart() noexcept { start_ = threadAllocStats(); }
+
+private:
+    AllocStats start_;
+};
+
+//--------------------------------------------------------------
+// FrameAllocTally — аллокации задач кадра со всех рабочих потоков
+//--------------------------------------------------------------
+class FrameAllocTally {
+public:
+    inline void add(const AllocStats& a) noexcept {
+        count_.fetch_add(a.count, std::memory_order_relaxed);
+        bytes_.fetch_add(a.bytes, std::memory_order_relaxed);
+    }
+
+    /// сумма с прошлого take(); вызывать, когда задачи кадра завершены
+    [[nodiscard]] inline AllocStats take() noexcept {
+        return {count_.exchange(0, std::memory_order_relaxed),
+                bytes_.exchange(0, std::memory_order_relaxed)};
+    }
+
+private:
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+};
+
+/// Первой строкой задачи кадра: её аллокации уходят в tally
+/// (без QRSLAM_COUNT_ALLOCS — ничего не делает).
+class TaskAllocProbe {
+public:
+    explicit TaskAllocProbe(FrameAllocTally& tally) : tally_{tally} {}
+    ~TaskAllocProbe() {
+        if constexpr (allocCountingEnabled()) tally_.add(probe_.delta());
+    }
+
+    TaskAllocProbe(const TaskAllocProbe&)            = delete;
+    TaskAllocProbe& operator=(const TaskAllocProbe&) = delete;
+
+private:
+    FrameAllocTally& tally_;
+    FrameAllocProbe  probe_;
+};
+
+} // namespace qrslam::util
@@ -0,0 +1,286 @@
+#pragma once
+/**
+ * @file   CameraModel.hpp
+ * @brief  Модели камеры как типы: пинхол, пинхол + Брауна–Конради,
+ *         fisheye (equidistant), и пакетные ядра project / unproject.
+ *
+ *  Модель выбирается один раз при старте (Camera.model в camera.yaml) и
+ *  хранится как std::variant. Диспетчеризация — один std::visit на пакет
+ *  точек: внутри цикла нет ни ветвления по типу объектива, ни проверки
+ *  «есть ли дисторсия», и компилятор получает отдельный цикл под каждую
+ *  модель. Прямое у пинхола и Брауна–Конради — без ветвлений (отсечка по
+ *  полю зрения — select), векторизуется. Обратное Брауна–Конради — проход
+ *  по таблице без проверок (вне таблицы — значение края) и отдельный
+ *  проход Ньютоном только по точкам вне неё; табличный проход — gather,
+ *  ему помогает отсутствие ветвлений, а не SIMD.
+ *
+ *  Соглашения у всех моделей одинаковые:
+ *   - project   — точка в СК камеры → пиксель кадра (NaN — точка за
+ *     областью, где модель откалибрована: ни в какой кадр не попадает);
+ *   - unproject — пиксель кадра → нормализованная точка на плоскости z = 1
+ *     (для fisheye — только поле зрения < 180°).
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <Eigen/Core>
+#include <opencv2/core.hpp>
+
+#include "LensDistortion.hpp"
+
+namespace qrslam::geom {
+
+//--------------------------------------------------------------
+// Модели
+//--------------------------------------------------------------
+
+/// Идеальный пинхол: u = fx·X/Z + cx.
+struct Pinhole {
+    static constexpr const char* kName = "pinhole";
+
+    double fx = 1.0, fy = 1.0, cx = 0.0, cy = 0.0;
+
+    void project(double X, double Y, double Z, double& u, double& v) const {
+        const double iz = 1.0 / Z;
+        u = fx * X * iz + cx;
+        v = fy * Y * iz + cy;
+    }
+
+    void unproject(double u, double v, double& x, double& y) const {
+        x = (u - cx) / fx;
+        y = (v - cy) / fy;
+    }
+};
+
+/**
+ * Пинхол + Брауна–Конради. Прямое преобразование — полином (дешевле
+ * таблицы и без ветвлений), обратное — таблица по кадру с шагом step,
+ * узлы которой решены Ньютоном; вне кадра — Ньютон напрямую.
+ *
+ * Полином верен лишь там, где его калибровали (в пределах кадра); дальше
+ * он немонотонен и «заворачивает» далёкие точки обратно в кадр. Поэтому
+ * project отдаёт NaN при r² выше r² углов кадра (с запасом kFovMargin).
+ */
+class PinholeBrownConrady {
+public:
+    static constexpr const char* kName = "pinhole+brown-conrady";
+
+    PinholeBrownConrady() = default;
+
+    /// @param width,height  размер кадра (область обратной таблицы)
+    PinholeBrownConrady(double fx, double fy, double cx, double cy,
+                        const BrownConrady& d, int width, int height, double step = 8.0)
+        : fx_{fx}, fy_{fy}, cx_{cx}, cy_{cy}, d_{d} {
+        if (width <= 0 || height <= 0) return;
+        // таблица общая у копий варианта: строится один раз
+        auto lut = std::make_shared<PixelLut>();
+        lut->build(0.0, 0.0, width - 1.0, height - 1.0, step, [this](double u, double v) {
+            double x, y;
+            d_.undistort((u - cx_) / fx_, (v - cy_) / fy_, x, y);
+            return cv::Point2f(static_cast<float>(x), static_cast<float>(y));
+        });
+        inv_ = std::move(lut);
+
+        // r² углов и середин сторон кадра на плоскости z = 1
+        double r2 = 0.0;
+        for (const double u : {0.0, 0.5 * (width - 1.0), width - 1.0})
+            for (const double v : {0.0, 0.5 * (height - 1.0), height - 1.0}) {
+                double x, y;
+                d_.undistort((u - cx_) / fx_, (v - cy_) / fy_, x, y);
+                r2 = std::max(r2, x * x + y * y);
+            }
+        r2_max_ = r2 * kFovMargin * kFovMargin;
+    }
+
+    const BrownConrady& coeffs() const { return d_; }
+
+    void project(double X, double Y, double Z, double& u, double& v) const {
+        const double iz = 1.0 / Z;
+        const double x = X * iz, y = Y * iz;
+        const double r2 = x * x + y * y;
+        const double radial = 1.0 + r2 * (d_.k1 + r2 * (d_.k2 + r2 * d_.k3));
+        // за областью калибровки — NaN; select, а не ветвление
+        const double off = r2 > r2_max_ ? std::numeric_limits<double>::quiet_NaN() : 0.0;
+        u = fx_ * (x * radial + 2.0 * d_.p1 * x * y + d_.p2 * (r2 + 2.0 * x * x)) + cx_ + off;
+        v = fy_ * (y * radial + d_.p1 * (r2 + 2.0 * y * y) + 2.0 * d_.p2 * x * y) + cy_ + off;
+    }
+
+    void unproject(double u, double v, double& x, double& y) const {
+        const cv::Point2f p(static_cast<float>(u), static_cast<float>(v));
+        if (inv_ && inv_->contains(p)) {
+            const cv::Point2f q = (*inv_)(p);
+            x = q.x;
+            y = q.y;
+        } else {
+            d_.undistort((u - cx_) / fx_, (v - cy_) / fy_, x, y);
+        }
+    }
+
+    /// Пакетное обратное (можно на месте): таблица — одним проходом без
+    /// проверок, точки вне неё (редко: углы QR и выборки глубины лежат
+    /// в кадре) — Ньютоном в отдельном проходе.
+    void unprojectBatch(const cv::Point2f* px, std::size_t n, cv::Point2f* xy) const {
+        if (!inv_) {
+            for (std::size_t i = 0; i < n; ++i) {
+                double x, y;
+                unproject(px[i].x, px[i].y, x, y);
+                xy[i] = {static_cast<float>(x), static_cast<float>(y)};
+            }
+            return;
+        }
+        std::size_t outside = 0;
+        for (std::size_t i = 0; i < n; ++i) outside += !inv_->contains(px[i]);
+
+        // Ньютон — до табличного прохода: xy может совпадать с px
+        std::vector<std::pair<std::size_t, cv::Point2f>> far;
+        if (outside > 0) {
+            far.reserve(outside);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (inv_->contains(px[i])) continue;
+                double x, y;
+                d_.undistort((px[i].x - cx_) / fx_, (px[i].y - cy_) / fy_, x, y);
+                far.emplace_back(i, cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i) xy[i] = (*inv_)(px[i]);
+        for (const auto& [i, q] : far) xy[i] = q;
+    }
+
+private:
+    static constexpr double kFovMargin = 1.1;   // радиус за углом кадра
+
+    double                          fx_ = 1.0, fy_ = 1.0, cx_ = 0.0, cy_ = 0.0;
+    BrownConrady                    d_;
+    std::shared_ptr<const PixelLut> inv_;   // пиксель → нормализованная точка
+    double                          r2_max_ = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * Fisheye / equidistant (модель OpenCV fisheye, Camera.model: fisheye):
+ * θ_d = θ·(1 + k1θ² + k2θ⁴ + k3θ⁶ + k4θ⁸), r_px ∝ θ_d.
+ * Обратное — фиксированное число шагов Ньютона по θ, без ветвлений.
+ */
+struct Fisheye {
+    static constexpr const char* kName = "fisheye";
+
+    double fx = 1.0, fy = 1.0, cx = 0.0, cy = 0.0;
+    double k1 = 0.0, k2 = 0.0, k3 = 0.0, k4 = 0.0;
+
+    void project(double X, double Y, double Z, double& u, double& v) const {
+        const double rho = std::sqrt(X * X + Y * Y);
+        const double th  = std::atan2(rho, Z);
+        const double t2  = th * th;
+        const double thd = th * (1.0 + t2 * (k1 + t2 * (k2 + t2 * (k3 + t2 * k4))));
+        // на оптической оси θ_d/ρ → 1/Z
+        const double s = rho > 1e-12 ? thd / rho : 1.0 / Z;
+        u = fx * X * s + cx;
+        v = fy * Y * s + cy;
+    }
+
+    void unproject(double u, double v, double& x, double& y) const {
+        constexpr int    kIters    = 8;
+        constexpr double kMaxTheta = 1.5707;    // чуть меньше π/2: tan конечен
+        const double xd  = (u - cx) / fx, yd = (v - cy) / fy;
+        const double thd = std::sqrt(xd * xd + yd * yd);
+        double th = thd;
+        for (int i = 0; i < kIters; ++i) {
+            const double t2 = th * th;
+            const double f  = th * (1.0 + t2 * (k1 + t2 * (k2 + t2 * (k3 + t2 * k4)))) - thd;
+            const double df = 1.0 + t2 * (3.0 * k1 + t2 * (5.0 * k2 + t2 * (7.0 * k3 + t2 * 9.0 * k4)));
+            th -= f / df;
+        }
+        th = std::clamp(th, 0.0, kMaxTheta);
+        const double s = thd > 1e-12 ? std::tan(th) / thd : 1.0;
+        x = xd * s;
+        y = yd * s;
+    }
+};
+
+using CameraModel = std::variant<Pinhole, PinholeBrownConrady, Fisheye>;
+
+//--------------------------------------------------------------
+// Пакетные ядра: шаблон под модель + одна диспетчеризация на пакет
+//--------------------------------------------------------------
+
+/// p_c[i] (СК камеры, z > 0) → px[i]
+template <class Model>
+inline void projectBatch(const Model& m, const Eigen::Vector3d* p_c, std::size_t n,
+                         cv::Point2f* px) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double u, v;
+        m.project(p_c[i].x(), p_c[i].y(), p_c[i].z(), u, v);
+        px[i] = {static_cast<float>(u), static_cast<float>(v)};
+    }
+}
+
+/// px[i] → xy[i] на плоскости z = 1 (можно на месте: xy == px)
+template <class Model>
+inline void unprojectBatch(const Model& m, const cv::Point2f* px, std::size_t n,
+                           cv::Point2f* xy) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double x, y;
+        m.unproject(px[i].x, px[i].y, x, y);
+        xy[i] = {static_cast<float>(x), static_cast<float>(y)};
+    }
+}
+
+/// Брауна–Конради: таблица и Ньютон — раздельными проходами
+inline void unprojectBatch(const PinholeBrownConrady& m, const cv::Point2f* px, std::size_t n,
+                           cv::Point2f* xy) {
+    m.unprojectBatch(px, n, xy);
+}
+
+inline void projectBatch(const CameraModel& cam, const Eigen::Vector3d* p_c, std::size_t n,
+                         cv::Point2f* px) {
+    std::visit([&](const auto& m) { projectBatch(m, p_c, n, px); }, cam);
+}
+
+inline void unprojectBatch(const CameraModel& cam, const cv::Point2f* px, std::size_t n,
+                           cv::Point2f* xy) {
+    std::visit([&](const auto& m) { unprojectBatch(m, px, n, xy); }, cam);
+}
+
+inline const char* cameraModelName(const CameraModel& cam) {
+    return std::visit([](const auto& m) { return m.kName; }, cam);
+}
+
+/**
+ * @brief  Модель из camera.yaml (формат openvslam): Camera.model,
+ *         Camera.fx/fy/cx/cy, Camera.k1..k4, Camera.p1/p2.
+ *
+ *  "perspective" / "pinhole" с нулевой дисторсией — чистый Pinhole.
+ *  Node — любой узел с operator[] и as<T>(default) (YAML::Node), чтобы
+ *  утилиты не зависели от yaml-cpp.
+ *
+ * @throws std::runtime_error  для моделей без ядер (equirectangular)
+ */
+template <class Node>
+CameraModel cameraModelFromConfig(const Node& node, int width, int height) {
+    const auto num = [&node](const char* key) { return node[key].template as<double>(0.0); };
+    const std::string model = node["Camera.model"].template as<std::string>("perspective");
+    const double fx = num("Camera.fx"), fy = num("Camera.fy");
+    const double cx = num("Camera.cx"), cy = num("Camera.cy");
+
+    if (model == "fisheye" || model == "equidistant")
+        return Fisheye{fx, fy, cx, cy,
+                       num("Camera.k1"), num("Camera.k2"), num("Camera.k3"), num("Camera.k4")};
+    if (model == "perspective" || model == "pinhole") {
+        const BrownConrady d{num("Camera.k1"), num("Camera.k2"), num("Camera.p1"),
+                             num("Camera.p2"), num("Camera.k3")};
+        if (d.isIdentity()) return Pinhole{fx, fy, cx, cy};
+        return PinholeBrownConrady(fx, fy, cx, cy, d, width, height);
+    }
+    throw std::runtime_error("Unsupported Camera.model: " + model);
+}
+
+} // namespace qrslam::geom
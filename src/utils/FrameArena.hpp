@@ -0,0 +1,80 @@
+#pragma once
+/**
+ * @file   FrameArena.hpp
+ * @brief  Кадровая арена (monotonic resource) для горячего пути.
+ *
+ *  Всё, что живёт не дольше одного кадра (временные векторы, результаты
+ *  projectMarkers и т.п.), берётся из заранее выделенного буфера и
+ *  освобождается разом вызовом reset() в конце кадра.
+ *
+ *  ✔ Header-only, только <memory_resource>.
+ *  ✔ Если буфера не хватило — арена «проливается» в кучу, это видно
+ *    по spilledBytes() и сигнал увеличить capacity.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+namespace qrslam::util {
+
+//--------------------------------------------------------------
+// SpillCounter — upstream-ресурс, считающий выходы за буфер арены
+//--------------------------------------------------------------
+class SpillCounter final : public std::pmr::memory_resource {
+public:
+    [[nodiscard]] std::uint64_t bytes() const noexcept { return bytes_; }
+    void clear() noexcept { bytes_ = 0; }
+
+private:
+    void* do_allocate(std::size_t n, std::size_t align) override {
+        bytes_ += n;
+        return std::pmr::new_delete_resource()->allocate(n, align);
+    }
+    void do_deallocate(void* p, std::size_t n, std::size_t align) override {
+        std::pmr::new_delete_resource()->deallocate(p, n, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        return this == &o;
+    }
+
+    std::uint64_t bytes_ = 0;
+};
+
+//--------------------------------------------------------------
+// FrameArena — monotonic-буфер, сбрасываемый раз в кадр
+//--------------------------------------------------------------
+class FrameArena {
+public:
+    explicit FrameArena(std::size_t capacity = 256 * 1024)
+        : buf_{new std::byte[capacity]}, cap_{capacity},
+          res_{buf_.get(), cap_, &spill_} {}
+
+    FrameArena(const FrameArena&)            = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /// ресурс для std::pmr-контейнеров текущего кадра
+    [[nodiscard]] std::pmr::memory_resource* resource() noexcept { return &res_; }
+
+    /// конец кадра: всё выданное становится недействительным
+    inline void reset() noexcept {
+        res_.release();
+        last_spill_ = spill_.bytes();
+        spill_.clear();
+    }
+
+    /// сколько байт ушло в кучу за прошлый кадр (0 — буфера хватило)
+    [[nodiscard]] std::uint64_t spilledBytes() const noexcept { return last_spill_; }
+    [[nodiscard]] std::size_t   capacity()     const noexcept { return cap_; }
+
+private:
+    std::unique_ptr<std::byte[]>        buf_;
+    std::size_t                         cap_;
+    SpillCounter                        spill_;
+    std::pmr::monotonic_buffer_resource res_;
+    std::uint64_t                       last_spill_ = 0;
+};
+
+} // namespace qrslam::util
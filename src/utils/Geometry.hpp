@@ -10,9 +10,15 @@
  * © 2025 YourCompany — MIT License.
  */
 
+#include <cstring>
+
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <opencv2/core.hpp>
+#include <opencv2/core/eigen.hpp>
+#include <opencv2/calib3d.hpp>   // cv::Rodrigues
+
+#include "CameraModel.hpp"
 
 namespace qrslam::geom {
 
@@ -62,18 +68,36 @@ inline Vec3d transformPoint(const Mat44d& T, const Vec3d& p) {
 }
 
 /**
- * @brief  Проекция 3-D точки в пиксели камеры K·[R|t]·P.
+ * @brief  Проекция 3-D точки в пиксели кадра моделью камеры @p cam
+ *         (Pinhole, PinholeBrownConrady, Fisheye или CameraModel).
+ * @return (u,v,depth)
+ */
+template <class Model>
+inline Eigen::Vector3d projectPoint(const Mat44d& T_cw,
+                                    const Model& cam,
+                                    const Vec3d& P_w) {
+    Vec3d p_c = transformPoint(T_cw, P_w);  // в камеру
+    p_c.z() += 1e-12;
+    double u, v;
+    cam.project(p_c.x(), p_c.y(), p_c.z(), u, v);
+    return {u, v, p_c.z()};
+}
+
+inline Eigen::Vector3d projectPoint(const Mat44d& T_cw,
+                                    const CameraModel& cam,
+                                    const Vec3d& P_w) {
+    return std::visit([&](const auto& m) { return projectPoint(T_cw, m, P_w); }, cam);
+}
+
+/**
+ * @brief  Проекция идеальным пинхолом K·[R|t]·P.
  * @param  K   3×3 (fx,0,cx; 0,fy,cy; 0,0,1)
  * @return (u,v,depth)
  */
 inline Eigen::Vector3d projectPoint(const Mat44d& T_cw,
                                     const Eigen::Matrix3d& K,
                                     const Vec3d& P_w) {
-    Vec3d p_c = transformPoint(T_cw, P_w);  // в камеру
-    double z  = p_c.z() + 1e-12;
-    double u  = (K(0,0)*p_c.x() + K(0,2)*z) / z;
-    double v  = (K(1,1)*p_c.y() + K(1,2)*z) / z;
-    return {u, v, z};
+    return projectPoint(T_cw, Pinhole{K(0,0), K(1,1), K(0,2), K(1,2)}, P_w);
 }
 
 /**
@@ -0,0 +1,130 @@
+#pragma once
+/**
+ * @file   LensDistortion.hpp
+ * @brief  Дисторсия Брауна–Конради (k1,k2,p1,p2,k3) и разреженная таблица
+ *         пиксель → точка с билинейной интерполяцией.
+ *
+ *  Полный кадр не переискажается: таблица строится один раз при старте
+ *  (см. PinholeBrownConrady в CameraModel.hpp), в узлах — итеративное
+ *  undistort (как cv::undistortPoints); на кадр через неё проходят только
+ *  углы QR и выборки глубины. Точки вне таблицы считаются напрямую.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace qrslam::geom {
+
+/// Коэффициенты в порядке OpenCV / camera.yaml.
+struct BrownConrady {
+    double k1 = 0.0, k2 = 0.0, p1 = 0.0, p2 = 0.0, k3 = 0.0;
+
+    bool isIdentity() const {
+        return k1 == 0.0 && k2 == 0.0 && p1 == 0.0 && p2 == 0.0 && k3 == 0.0;
+    }
+
+    /// нормализованные координаты: идеальные → искажённые
+    void distort(double x, double y, double& xd, double& yd) const {
+        const double r2 = x * x + y * y;
+        const double radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+        xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+        yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+    }
+
+    /**
+     * искажённые → идеальные. Ньютон с аналитическим якобианом:
+     * простая итерация cv::undistortPoints на углах кадра при заметной
+     * бочке расходится. Шаг укорачивается, пока невязка не уменьшится, —
+     * иначе Ньютон перепрыгивает за «складку» полинома (det J ≤ 0).
+     */
+    void undistort(double xd, double yd, double& x, double& y, int iters = 20) const {
+        x = xd;
+        y = yd;
+        double ex, ey;
+        distort(x, y, ex, ey);
+        ex -= xd;
+        ey -= yd;
+        double err = ex * ex + ey * ey;
+        for (int i = 0; i < iters && err > 1e-24; ++i) {
+            const double r2 = x * x + y * y;
+            const double R  = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+            const double dR = k1 + r2 * (2.0 * k2 + 3.0 * r2 * k3);   // dR/d(r²)
+            const double a = R + 2.0 * x * x * dR + 2.0 * p1 * y + 6.0 * p2 * x;
+            const double b = 2.0 * x * y * dR + 2.0 * p1 * x + 2.0 * p2 * y;
+            const double d = R + 2.0 * y * y * dR + 6.0 * p1 * y + 2.0 * p2 * x;
+            const double det = a * d - b * b;       // J симметричен: ∂xd/∂y = ∂yd/∂x
+            if (det <= 1e-12) break;
+            const double sx = ( d * ex - b * ey) / det;
+            const double sy = (-b * ex + a * ey) / det;
+
+            bool improved = false;
+            for (double t = 1.0; t > 1e-3 && !improved; t *= 0.5) {
+                double nx, ny;
+                distort(x - t * sx, y - t * sy, nx, ny);
+                nx -= xd;
+                ny -= yd;
+                if (nx * nx + ny * ny < err) {
+                    x -= t * sx;
+                    y -= t * sy;
+                    ex = nx;
+                    ey = ny;
+                    err = nx * nx + ny * ny;
+                    improved = true;
+                }
+            }
+            if (!improved) break;
+        }
+    }
+};
+
+/// Регулярная сетка пиксель → точка с билинейной интерполяцией.
+class PixelLut {
+public:
+    template <class Fn>
+    void build(double x0, double y0, double x1, double y1, double step, Fn&& fn) {
+        x0_ = x0;
+        y0_ = y0;
+        step_ = step;
+        inv_step_ = 1.0 / step;
+        gw_ = std::max(2, static_cast<int>(std::ceil((x1 - x0) * inv_step_)) + 1);
+        gh_ = std::max(2, static_cast<int>(std::ceil((y1 - y0) * inv_step_)) + 1);
+        grid_.resize(static_cast<std::size_t>(gw_) * gh_);
+        for (int j = 0; j < gh_; ++j)
+            for (int i = 0; i < gw_; ++i)
+                grid_[static_cast<std::size_t>(j) * gw_ + i] = fn(x0 + i * step, y0 + j * step);
+    }
+
+    bool empty() const { return grid_.empty(); }
+
+    bool contains(const cv::Point2f& p) const {
+        return !grid_.empty() &&
+               p.x >= x0_ && p.x <= x0_ + (gw_ - 1) * step_ &&
+               p.y >= y0_ && p.y <= y0_ + (gh_ - 1) * step_;
+    }
+
+    /// точное значение для contains(p); вне таблицы — значение ближайшего
+    /// края (без ветвлений: пакетный проход не проверяет каждую точку)
+    cv::Point2f operator()(const cv::Point2f& p) const {
+        const double gx = std::clamp((p.x - x0_) * inv_step_, 0.0, gw_ - 1.000001);
+        const double gy = std::clamp((p.y - y0_) * inv_step_, 0.0, gh_ - 1.000001);
+        const int    ix = static_cast<int>(gx), iy = static_cast<int>(gy);
+        const float  fx = static_cast<float>(gx - ix), fy = static_cast<float>(gy - iy);
+
+        const cv::Point2f* r0 = &grid_[static_cast<std::size_t>(iy) * gw_ + ix];
+        const cv::Point2f* r1 = r0 + gw_;
+        const cv::Point2f top = r0[0] + (r0[1] - r0[0]) * fx;
+        const cv::Point2f bot = r1[0] + (r1[1] - r1[0]) * fx;
+        return top + (bot - top) * fy;
+    }
+
+private:
+    double                   x0_ = 0.0, y0_ = 0.0, step_ = 1.0, inv_step_ = 1.0;
+    int                      gw_ = 0, gh_ = 0;
+    std::vector<cv::Point2f> grid_;
+};
+
+} // namespace qrslam::geom
@@ -0,0 +1,194 @@
+#pragma once
+/**
+ * @file   Lz.hpp
+ * @brief  Быстрый байтовый LZ-компрессор (формат блока в духе LZ4).
+ *
+ *  Последовательность: token [lit_ext…] literals off16 [match_ext…],
+ *  token = (lit_len:4 | match_len−4:4), 15 → продолжение байтами 255…
+ *  Последняя последовательность — только литералы.
+ *
+ *  ✔ Header-only, только STL.
+ *  ✔ Хеш-таблица 64K позиций, ускоренный пропуск несжимаемых участков —
+ *    шумные кадры камеры не тормозят запись.
+ *  ✔ Декодер проверяет все границы (повреждённый лог → false, не UB).
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace qrslam::util {
+
+class LzCodec {
+public:
+    LzCodec() : table_(kHashSize) {}
+
+    /// Гарантированный размер выходного буфера для n байт входа.
+    static constexpr std::size_t bound(std::size_t n) { return n + n / 255 + 16; }
+
+    /**
+     * @brief  Сжать src[0..n) в dst (ёмкость cap >= bound(n)).
+     * @return размер сжатых данных; 0 — не хватило cap.
+     */
+    std::size_t compress(const std::uint8_t* src, std::size_t n,
+                         std::uint8_t* dst, std::size_t cap) {
+        std::uint8_t*       op   = dst;
+        std::uint8_t* const oend = dst + cap;
+        const std::uint8_t* anchor = src;
+        const std::uint8_t* const end = src + n;
+
+        if (n >= kMinInput) {
+            std::fill(table_.begin(), table_.end(), 0u);
+            const std::uint8_t* const mflimit    = end - kMfLimit;
+            const std::uint8_t* const matchlimit = end - kLastLiterals;
+            const std::uint8_t* ip = src + 1;
+            unsigned misses = 0;
+
+            while (ip < mflimit) {
+                const std::uint32_t seq = read32(ip);
+                std::uint32_t& slot = table_[hash(seq)];
+                const std::uint8_t* ref = src + slot;
+                slot = static_cast<std::uint32_t>(ip - src);
+
+                if (ip - ref > kMaxOffset || ref >= ip || read32(ref) != seq) {
+                    ip += 1 + (misses++ >> kSkipTrigger);
+                    continue;
+                }
+                misses = 0;
+
+                // расширяем назад (после пропусков) и вперёд
+                while (ip > anchor && ref > src && ip[-1] == ref[-1]) { --ip; --ref; }
+                const std::uint8_t* mp = ip + kMinMatch;
+                const std::uint8_t* mr = ref + kMinMatch;
+                while (mp < matchlimit && *mp == *mr) { ++mp; ++mr; }
+
+                if (!emit(op, oend, anchor, static_cast<std::size_t>(ip - anchor),
+                          static_cast<std::uint16_t>(ip - ref),
+                          static_cast<std::size_t>(mp - ip - kMinMatch)))
+                    return 0;
+
+                ip = anchor = mp;
+                if (ip < mflimit)
+                    table_[hash(read32(ip - 2))] = static_cast<std::uint32_t>(ip - 2 - src);
+            }
+        }
+
+        // хвост — только литералы
+        const std::size_t lit = static_cast<std::size_t>(end - anchor);
+        if (!emitLiterals(op, oend, anchor, lit, 0)) return 0;
+        return static_cast<std::size_t>(op - dst);
+    }
+
+    /**
+     * @brief  Распаковать ровно out_n байт.
+     * @return false — данные повреждены или размер не совпал.
+     */
+    static bool decompress(const std::uint8_t* src, std::size_t n,
+                           std::uint8_t* dst, std::size_t out_n) {
+        const std::uint8_t*       ip   = src;
+        const std::uint8_t* const end  = src + n;
+        std::uint8_t*             op   = dst;
+        std::uint8_t* const       oend = dst + out_n;
+
+        while (ip < end) {
+            const std::uint8_t token = *ip++;
+
+            std::size_t lit = token >> 4;
+            if (lit == 15 && !readExt(ip, end, lit)) return false;
+            if (lit > static_cast<std::size_t>(end - ip) ||
+                lit > static_cast<std::size_t>(oend - op)) return false;
+            std::memcpy(op, ip, lit);
+            op += lit;
+            ip += lit;
+            if (ip >= end) break;                       // последняя последовательность
+
+            if (end - ip < 2) return false;
+            const std::size_t off = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+            ip += 2;
+            if (off == 0 || off > static_cast<std::size_t>(op - dst)) return false;
+
+            std::size_t mlen = token & 15;
+            if (mlen == 15 && !readExt(ip, end, mlen)) return false;
+            mlen += kMinMatch;
+            if (mlen > static_cast<std::size_t>(oend - op)) return false;
+
+            const std::uint8_t* m = op - off;
+            if (off >= mlen) {
+                std::memcpy(op, m, mlen);
+            } else {
+                for (std::size_t i = 0; i < mlen; ++i) op[i] = m[i];   // перекрытие
+            }
+            op += mlen;
+        }
+        return op == oend;
+    }
+
+private:
+    static constexpr int         kHashLog      = 16;
+    static constexpr std::size_t kHashSize     = std::size_t{1} << kHashLog;
+    static constexpr std::size_t kMinMatch     = 4;
+    static constexpr std::size_t kLastLiterals = 5;
+    static constexpr std::size_t kMfLimit      = 12;
+    static constexpr std::size_t kMinInput     = kMfLimit + 1;
+    static constexpr std::ptrdiff_t kMaxOffset = 65535;
+    static constexpr unsigned    kSkipTrigger  = 6;     // шаг растёт каждые 64 промаха
+
+    static inline std::uint32_t read32(const std::uint8_t* p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static inline std::uint32_t hash(std::uint32_t v) {
+        return (v * 2654435761u) >> (32 - kHashLog);
+    }
+
+    static inline bool writeExt(std::uint8_t*& op, std::uint8_t* oend, std::size_t v) {
+        while (v >= 255) {
+            if (op >= oend) return false;
+            *op++ = 255;
+            v -= 255;
+        }
+        if (op >= oend) return false;
+        *op++ = static_cast<std::uint8_t>(v);
+        return true;
+    }
+    static inline bool readExt(const std::uint8_t*& ip, const std::uint8_t* end, std::size_t& v) {
+        std::uint8_t b;
+        do {
+            if (ip >= end) return false;
+            b = *ip++;
+            v += b;
+        } while (b == 255);
+        return true;
+    }
+
+    /// token + литералы; match_nib — младшие 4 бита токена
+    static inline bool emitLiterals(std::uint8_t*& op, std::uint8_t* oend,
+                                    const std::uint8_t* lit_src, std::size_t lit,
+                                    std::uint8_t match_nib) {
+        if (op >= oend) return false;
+        std::uint8_t* token = op++;
+        *token = static_cast<std::uint8_t>(((lit >= 15 ? 15 : lit) << 4) | match_nib);
+        if (lit >= 15 && !writeExt(op, oend, lit - 15)) return false;
+        if (lit > static_cast<std::size_t>(oend - op)) return false;
+        std::memcpy(op, lit_src, lit);
+        op += lit;
+        return true;
+    }
+
+    static inline bool emit(std::uint8_t*& op, std::uint8_t* oend,
+                            const std::uint8_t* lit_src, std::size_t lit,
+                            std::uint16_t off, std::size_t mlen) {
+        const auto nib = static_cast<std::uint8_t>(mlen >= 15 ? 15 : mlen);
+        if (!emitLiterals(op, oend, lit_src, lit, nib)) return false;
+        if (oend - op < 2) return false;
+        *op++ = static_cast<std::uint8_t>(off & 0xFF);
+        *op++ = static_cast<std::uint8_t>(off >> 8);
+        return mlen < 15 || writeExt(op, oend, mlen - 15);
+    }
+
+    std::vector<std::uint32_t> table_;
+};
+
+} // namespace qrslam::util
@@ -0,0 +1,243 @@
+#pragma once
+/**
+ * @file   Trace.hpp
+ * @brief  Покадровая трассировка стадий конвейера → Chrome/Perfetto JSON.
+ *
+ *  Каждый кадр получает frame_id; стадии (capture, convert, slam, qr, pnp,
+ *  overlay …) пишут begin/end-события в буфер своего потока:
+ *
+ *      trace::Scope sc("slam", frame_id);
+ *
+ *  ✔ Header-only, только STL.
+ *  ✔ Буферы потоков — кольцевые фиксированной ёмкости, запись без heap.
+ *  ✔ Выключено → одна relaxed-загрузка atomic<bool> на стадию.
+ *
+ *  Дамп открывается в chrome://tracing или ui.perfetto.dev.
+ *
+ * © 2025 YourCompany — MIT License.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace qrslam::trace {
+
+//--------------------------------------------------------------
+// Событие: завершённый интервал одной стадии одного кадра
+//--------------------------------------------------------------
+struct Event {
+    const char*   name;       ///< строковый литерал (не копируется)
+    std::uint64_t frame;      ///< frame_id
+    std::int64_t  begin_ns;
+    std::int64_t  end_ns;
+};
+
+inline std::int64_t nowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//--------------------------------------------------------------
+// ThreadBuffer — кольцо событий одного потока
+//--------------------------------------------------------------
+class ThreadBuffer {
+public:
+    ThreadBuffer(std::uint32_t tid, std::size_t capacity)
+        : tid_{tid}, ring_(capacity) {}
+
+    inline void push(const Event& e) {
+        std::lock_guard<std::mutex> lk(m_);       // почти всегда без конкуренции
+        ring_[head_ % ring_.size()] = e;
+        ++head_;
+    }
+
+    /// копия событий в хронологическом порядке записи
+    std::vector<Event> snapshot() const {
+        std::lock_guard<std::mutex> lk(m_);
+        const std::size_t n = std::min<std::size_t>(head_, ring_.size());
+        std::vector<Event> out;
+        out.reserve(n);
+        for (std::size_t i = head_ - n; i < head_; ++i)
+            out.push_back(ring_[i % ring_.size()]);
+        return out;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lk(m_);
+        head_ = 0;
+    }
+
+    [[nodiscard]] std::uint32_t tid() const { return tid_; }
+
+private:
+    std::uint32_t       tid_;
+    mutable std::mutex  m_;
+    std::vector<Event>  ring_;
+    std::size_t         head_ = 0;
+};
+
+//--------------------------------------------------------------
+// Tracer — реестр буферов потоков + экспорт
+//--------------------------------------------------------------
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer t;
+        return t;
+    }
+
+    void enable(bool on, std::size_t events_per_thread = 1 << 16) {
+        capacity_ = events_per_thread;
+        enabled_.store(on, std::memory_order_relaxed);
+    }
+    [[nodiscard]] bool enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /// буфер вызывающего потока (создаётся при первом обращении)
+    ThreadBuffer& local() {
+        thread_local std::shared_ptr<ThreadBuffer> buf = registerThread();
+        return *buf;
+    }
+
+    inline void record(const char* name, std::uint64_t frame,
+                       std::int64_t begin_ns, std::int64_t end_ns) {
+        if (!enabled()) return;
+        local().push({name, frame, begin_ns, end_ns});
+    }
+
+    /**
+     * @brief  Записать все события в формате Chrome Trace Event (JSON).
+     *         ts/dur — в микросекундах, frame_id — в args.
+     */
+    bool dumpChromeJson(const std::string& path) const {
+        std::ofstream os(path);
+        if (!os) return false;
+
+        std::vector<std::shared_ptr<ThreadBuffer>> bufs;
+        {
+            std::lock_guard<std::mutex> lk(reg_m_);
+            bufs = buffers_;
+        }
+
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& b : bufs) {
+            for (const Event& e : b->snapshot()) {
+                os << (first ? "" : ",\n")
+                   << "{\"name\":\"" << e.name << "\",\"cat\":\"frame\",\"ph\":\"X\""
+                   << ",\"pid\":1,\"tid\":" << b->tid()
+                   << ",\"ts\":"  << (e.begin_ns - epoch_ns_) / 1000.0
+                   << ",\"dur\":" << (e.end_ns - e.begin_ns) / 1000.0
+                   << ",\"args\":{\"frame\":" << e.frame << "}}";
+                first = false;
+            }
+        }
+        os << "\n]}\n";
+        return static_cast<bool>(os);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lk(reg_m_);
+        for (auto& b : buffers_) b->clear();
+    }
+
+private:
+    Tracer() : epoch_ns_{nowNs()} {}
+
+    std::shared_ptr<ThreadBuffer> registerThread() {
+        std::lock_guard<std::mutex> lk(reg_m_);
+        auto b = std::make_shared<ThreadBuffer>(
+            static_cast<std::uint32_t>(buffers_.size() + 1), capacity_);
+        buffers_.push_back(b);
+        return b;
+    }
+
+    std::atomic<bool>                          enabled_{false};
+    std::size_t                                capacity_ = 1 << 16;
+    std::int64_t                               epoch_ns_;
+    mutable std::mutex                         reg_m_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+//--------------------------------------------------------------
+// Scope — RAII-интервал стадии
+//--------------------------------------------------------------
+class Scope {
+public:
+    Scope(const char* name, std::uint64_t frame)
+        : name_{name}, frame_{frame},
+          begin_{Tracer::instance().enabled() ? nowNs() : 0} {}
+
+    ~Scope() { end(); }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    /// закрыть интервал досрочно; возвращает время конца (0 — трасса выкл.)
+    inline std::int64_t end() {
+        if (done_ || begin_ == 0) { done_ = true; return end_; }
+        end_  = nowNs();
+        done_ = true;
+        Tracer::instance().record(name_, frame_, begin_, end_);
+        return end_;
+    }
+
+    [[nodiscard]] std::int64_t beginNs() const { return begin_; }
+
+private:
+    const char*   name_;
+    std::uint64_t frame_;
+    std::int64_t  begin_;
+    std::int64_t  end_  = 0;
+    bool          done_ = false;
+};
+
+//--------------------------------------------------------------
+// LatencyStats — сквозная задержка «стекло → overlay»
+//--------------------------------------------------------------
+class LatencyStats {
+public:
+    /// кадр получен (конец capture) и нарисован overlay, nowNs();
+    /// меряется и при выключенной трассировке
+    inline void add(std::int64_t glass_ns, std::int64_t overlay_end_ns) {
+        if (glass_ns == 0 || overlay_end_ns == 0) return;
+        const double ms = (overlay_end_ns - glass_ns) * 1e-6;
+        ++n_;
+        sum_ += ms;
+        max_  = std::max(max_, ms);
+        min_  = (n_ == 1) ? ms : std::min(min_, ms);
+        const auto bin = std::min<std::size_t>(static_cast<std::size_t>(ms), kBins - 1);
+        ++hist_[bin];
+    }
+
+    [[nodiscard]] std::uint64_t count() const { return n_; }
+    [[nodiscard]] double mean() const { return n_ ? sum_ / n_ : 0.0; }
+    [[nodiscard]] double min()  const { return min_; }
+    [[nodiscard]] double max()  const { return max_; }
+
+    /// перцентиль по гистограмме с шагом 1 мс
+    [[nodiscard]] double percentile(double q) const {
+        const auto target = static_cast<std::uint64_t>(q * n_);
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i < kBins; ++i) {
+            acc += hist_[i];
+            if (acc > target) return static_cast<double>(i + 1);
+        }
+        return max_;
+    }
+
+private:
+    static constexpr std::size_t kBins = 512;   // 0…511 мс
+    std::uint64_t n_   = 0;
+    double        sum_ = 0.0, min_ = 0.0, max_ = 0.0;
+    std::uint64_t hist_[kBins] = {};
+};
+
+} // namespace qrslam::trace